@@ -0,0 +1,60 @@
+/*
+ * barrier.c -- primitive process barrier
+ * Copyright (C) 2022  Jacob Koziej <jacobkoziej@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "barrier.h"
+
+#include <limits.h>
+#include <stdatomic.h>
+
+#include "futex.h"
+
+
+void barrier_init(struct barrier *barrier, unsigned int n)
+{
+	barrier->n = n;
+	atomic_init(&barrier->count, 0);
+	atomic_init(&barrier->gen, 0);
+}
+
+// returns one to exactly one of the callers of each generation, much
+// like PTHREAD_BARRIER_SERIAL_THREAD
+int barrier_wait(struct barrier *barrier)
+{
+	unsigned int gen = atomic_load_explicit(
+		&barrier->gen,
+		memory_order_acquire);
+
+	if (atomic_fetch_add_explicit(
+		&barrier->count,
+		1,
+		memory_order_acq_rel) + 1 == barrier->n) {
+		// nobody from the next round can arrive until they've seen
+		// the new generation, so the reset can't race with them
+		atomic_store_explicit(&barrier->count, 0, memory_order_relaxed);
+		atomic_fetch_add_explicit(&barrier->gen, 1, memory_order_release);
+
+		futex_wake(&barrier->gen, INT_MAX);
+
+		return 1;
+	}
+
+	while (atomic_load_explicit(&barrier->gen, memory_order_acquire) == gen)
+		futex_wait(&barrier->gen, gen);
+
+	return 0;
+}
@@ -0,0 +1,40 @@
+/*
+ * barrier.h -- primitive process barrier
+ * Copyright (C) 2022  Jacob Koziej <jacobkoziej@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef BARRIER_H
+#define BARRIER_H
+
+
+#include <stdatomic.h>
+
+
+// gen doubles as the futex word: waiters sleep until the last arrival
+// of their generation bumps it, by which point count has been reset
+// for the next round
+struct barrier {
+	unsigned int n;
+	atomic_uint  count;
+	atomic_uint  gen;
+};
+
+
+void barrier_init(struct barrier *barrier, unsigned int n);
+int  barrier_wait(struct barrier *barrier);
+
+
+#endif /* BARRIER_H */
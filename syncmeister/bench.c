@@ -0,0 +1,333 @@
+/*
+ * bench.c -- benchmark syncmeister primitives
+ * Copyright (C) 2022  Jacob Koziej <jacobkoziej@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "cv.h"
+#include "fifo.h"
+#include "mutex.h"
+#include "spinlock.h"
+
+
+enum {
+	BENCH_CV,
+	BENCH_FIFO,
+	BENCH_LOCK,
+	BENCH_MUTEX,
+};
+
+static const char *const workloads[] = {
+	[BENCH_CV]    = "cv",
+	[BENCH_FIFO]  = "fifo",
+	[BENCH_LOCK]  = "lock",
+	[BENCH_MUTEX] = "mutex",
+};
+
+
+// the cv workload hands one timestamp at a time through a single slot,
+// so every item costs a wakeup on each side
+struct mailbox {
+	struct spinlock mutex;
+	struct cv       full;
+	struct cv       empty;
+	int             has;
+	unsigned long   stamp;
+};
+
+struct shared {
+	struct mailbox  mailbox;
+	struct mutex    mutex;
+	struct spinlock lock;
+	unsigned long   lat[];
+};
+
+
+static unsigned long now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ts.tv_sec * 1000000000ul + ts.tv_nsec;
+}
+
+// keeps a producer to its share of the requested rate without drifting
+static void pace(unsigned long start, unsigned long j, unsigned long rate)
+{
+	if (!rate) return;
+
+	unsigned long   when = start + j * (1000000000ul / rate);
+	struct timespec ts   = {
+		.tv_sec  = when / 1000000000ul,
+		.tv_nsec = when % 1000000000ul,
+	};
+
+	clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL);
+}
+
+static int cmp(const void *a, const void *b)
+{
+	unsigned long x = *(const unsigned long *) a;
+	unsigned long y = *(const unsigned long *) b;
+
+	return (x > y) - (x < y);
+}
+
+static unsigned long percentile(const unsigned long *lat, size_t n, double p)
+{
+	return (n) ? lat[(size_t) (p * (n - 1))] : 0;
+}
+
+static void produce(
+	struct shared *shm,
+	struct fifo   *fifo,
+	int            workload,
+	unsigned long  ops,
+	unsigned long  rate,
+	unsigned long *lat)
+{
+	struct mailbox *mb    = &shm->mailbox;
+	unsigned long   start = now();
+
+	for (unsigned long j = 0; j < ops; j++) {
+		pace(start, j, rate);
+
+		unsigned long t = now();
+
+		switch (workload) {
+			case BENCH_CV:
+				spinlock_lock(&mb->mutex);
+
+				while (mb->has) cv_wait(&mb->empty, &mb->mutex);
+
+				mb->has   = 1;
+				mb->stamp = now();
+
+				cv_signal(&mb->full);
+				spinlock_unlock(&mb->mutex);
+				break;
+
+			case BENCH_FIFO:
+				fifo_wr(fifo, t);
+				break;
+
+			// the lock workloads have no consumers, so the latency
+			// is just how long it took to get the lock
+			case BENCH_LOCK:
+				spinlock_lock(&shm->lock);
+				lat[j] = now() - t;
+				spinlock_unlock(&shm->lock);
+				break;
+
+			case BENCH_MUTEX:
+				mutex_lock(&shm->mutex);
+				lat[j] = now() - t;
+				mutex_unlock(&shm->mutex);
+				break;
+		}
+	}
+}
+
+static void consume(
+	struct shared *shm,
+	struct fifo   *fifo,
+	int            workload,
+	unsigned long  ops,
+	unsigned long *lat)
+{
+	struct mailbox *mb = &shm->mailbox;
+	unsigned long   stamp;
+
+	for (unsigned long j = 0; j < ops; j++) {
+		switch (workload) {
+			case BENCH_CV:
+				spinlock_lock(&mb->mutex);
+
+				while (!mb->has) cv_wait(&mb->full, &mb->mutex);
+
+				lat[j]  = now() - mb->stamp;
+				mb->has = 0;
+
+				cv_signal(&mb->empty);
+				spinlock_unlock(&mb->mutex);
+				break;
+
+			// the read has to be sequenced before taking the time
+			case BENCH_FIFO:
+				stamp  = fifo_rd(fifo);
+				lat[j] = now() - stamp;
+				break;
+		}
+	}
+}
+
+int main(int argc, char **argv)
+{
+	unsigned long producers = 1;
+	unsigned long consumers = 1;
+	unsigned long ops       = 100000;
+	unsigned long rate      = 0;
+	int           workload  = BENCH_FIFO;
+
+	int opt;
+	while ((opt = getopt(argc, argv, "c:n:p:r:w:")) != -1) {
+		switch (opt) {
+			case 'c':
+				consumers = strtoul(optarg, NULL, 0);
+				break;
+
+			case 'n':
+				ops = strtoul(optarg, NULL, 0);
+				break;
+
+			case 'p':
+				producers = strtoul(optarg, NULL, 0);
+				break;
+
+			case 'r':
+				rate = strtoul(optarg, NULL, 0);
+				break;
+
+			case 'w':
+				for (workload = 0; workload <= BENCH_MUTEX; workload++)
+					if (!strcmp(optarg, workloads[workload])) break;
+
+				if (workload > BENCH_MUTEX) {
+					fprintf(stderr, "unknown workload `%s`\n", optarg);
+					return EXIT_FAILURE;
+				}
+				break;
+
+			default:
+				return EXIT_FAILURE;
+		}
+	}
+
+	int handoff = workload == BENCH_CV || workload == BENCH_FIFO;
+
+	if (!handoff) consumers = 0;
+
+	if (!producers || (handoff && !consumers)) {
+		fputs("need at least one producer and consumer\n", stderr);
+		return EXIT_FAILURE;
+	}
+
+	unsigned long total = producers * ops;
+
+	size_t size = sizeof(struct shared) + sizeof(unsigned long) * total;
+
+	struct shared *shm = mmap(
+		NULL,
+		size,
+		PROT_READ | PROT_WRITE,
+		MAP_ANONYMOUS | MAP_SHARED,
+		-1,
+		0);
+
+	if (shm == MAP_FAILED) {
+		perror("failed to `mmap()` shm");
+		return EXIT_FAILURE;
+	}
+
+	memset(shm, 0, sizeof(*shm));
+	cv_init(&shm->mailbox.full);
+	cv_init(&shm->mailbox.empty);
+	mutex_init(&shm->mutex);
+
+	struct fifo *fifo = fifo_create(NULL, FIFO_BUFSIZ);
+
+	if (!fifo) {
+		perror("failed to `fifo_create()` fifo");
+		return EXIT_FAILURE;
+	}
+
+	unsigned long start = now();
+
+	for (unsigned long i = 0; i < producers; i++) {
+		pid_t pid = fork();
+
+		if (pid < 0) {
+			perror("failed to `fork()` producers");
+			return EXIT_FAILURE;
+		}
+
+		if (pid) continue;
+
+		produce(shm, fifo, workload, ops, rate, &shm->lat[i * ops]);
+
+		return EXIT_SUCCESS;
+	}
+
+	// split the reads as evenly as possible between consumers, each
+	// filling in its own stretch of the latency samples
+	for (unsigned long i = 0; i < consumers; i++) {
+		pid_t pid = fork();
+
+		if (pid < 0) {
+			perror("failed to `fork()` consumers");
+			return EXIT_FAILURE;
+		}
+
+		if (pid) continue;
+
+		unsigned long reads = total / consumers + (i < total % consumers);
+		unsigned long off   = i * (total / consumers)
+			+ ((i < total % consumers) ? i : total % consumers);
+
+		consume(shm, fifo, workload, reads, &shm->lat[off]);
+
+		return EXIT_SUCCESS;
+	}
+
+	for (unsigned long i = 0; i < producers + consumers; i++) wait(NULL);
+
+	double elapsed = (now() - start) / 1e9;
+
+	struct rusage usage;
+	getrusage(RUSAGE_CHILDREN, &usage);
+
+	qsort(shm->lat, total, sizeof(*shm->lat), cmp);
+
+	// one JSON object per run so sweeps can be appended to a file and
+	// compared across commits
+	printf(
+		"{\"workload\":\"%s\",\"producers\":%lu,\"consumers\":%lu,"
+		"\"ops\":%lu,\"rate\":%lu,\"elapsed_s\":%.6f,\"ops_per_s\":%.0f,"
+		"\"p50_ns\":%lu,\"p99_ns\":%lu,\"p999_ns\":%lu,"
+		"\"nvcsw\":%ld,\"nivcsw\":%ld}\n",
+		workloads[workload],
+		producers,
+		consumers,
+		total,
+		rate,
+		elapsed,
+		total / elapsed,
+		percentile(shm->lat, total, 0.50),
+		percentile(shm->lat, total, 0.99),
+		percentile(shm->lat, total, 0.999),
+		usage.ru_nvcsw,
+		usage.ru_nivcsw);
+
+	return EXIT_SUCCESS;
+}
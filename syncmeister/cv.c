@@ -18,29 +18,153 @@
 
 #include "cv.h"
 
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
 #include <signal.h>
 #include <stddef.h>
 #include <string.h>
+#include <sys/syscall.h>
+#include <time.h>
 #include <unistd.h>
 
 #include "spinlock.h"
+#include "stats.h"
 
 
+#ifdef CV_FUTEX
+
+#include <limits.h>
+
+#include "ec.h"
+
+
+void cv_attach(struct cv *cv)
+{
+	(void) cv;
+}
+
+void cv_broadcast(struct cv *cv)
+{
+	STAT_INC(cv->stats.broadcasts);
+	ec_notify(&cv->ec, INT_MAX);
+}
+
+void cv_init(struct cv *cv)
+{
+	ec_init(&cv->ec);
+}
+
+int cv_signal(struct cv *cv)
+{
+	STAT_INC(cv->stats.signals);
+	return ec_notify(&cv->ec, 1);
+}
+
+int cv_timedwait(
+	struct cv             *cv,
+	struct spinlock       *mutex,
+	const struct timespec *abstime)
+{
+	unsigned long start = STAT_CLOCK();
+	unsigned int  key   = ec_prepare(&cv->ec);
+
+	STAT_INC(cv->stats.waits);
+
+	spinlock_unlock(mutex);
+
+	int ret = ec_timedwait(&cv->ec, key, abstime);
+	int err = errno;
+
+	STAT_ADD(cv->stats.wait_ns, STAT_CLOCK() - start);
+
+	spinlock_lock(mutex);
+
+	// EAGAIN and EINTR are just early returns
+	if (ret < 0 && err == ETIMEDOUT) {
+		errno = ETIMEDOUT;
+		return -1;
+	}
+
+	return 0;
+}
+
+int cv_wait(struct cv *cv, struct spinlock *mutex)
+{
+	return cv_timedwait(cv, mutex, NULL);
+}
+
+#else
+
 static void cv_sigusr1_handler(int sig)
 {
 	(void) sig;
 }
 
+static struct cv_waiter cv_self(void)
+{
+	return (struct cv_waiter) {
+		.tgid = getpid(),
+		.tid  = syscall(SYS_gettid),
+	};
+}
 
-void cv_broadcast(struct cv *cv)
+// a thread-directed signal, since with kill() any thread in the
+// process that doesn't block SIGUSR1 could end up taking it
+static int cv_wake(const struct cv_waiter *waiter)
 {
-	// we can miss an unlikely kill() failure here
-	while (cv_signal(cv) < 0);
+	return syscall(SYS_tgkill, waiter->tgid, waiter->tid, SIGUSR1);
 }
 
-void cv_init(struct cv *cv)
+// takes tid back off the wait queue, returning zero if it wasn't there
+static int cv_dequeue(struct cv *cv, pid_t tid)
 {
-	memset(cv, 0, sizeof(*cv));
+	for (size_t i = 0; i < cv->use; i++) {
+		size_t k = (cv->head + i) % CV_MAXPROC;
+
+		if (cv->waiter[k].tid != tid) continue;
+
+		for (; i + 1 < cv->use; i++, k = (k + 1) % CV_MAXPROC)
+			cv->waiter[k] = cv->waiter[(k + 1) % CV_MAXPROC];
+
+		--cv->use;
+		cv->tail = (cv->tail + CV_MAXPROC - 1) % CV_MAXPROC;
+
+		return 1;
+	}
+
+	return 0;
+}
+
+// fills in how long until abstime, returning zero once it has passed
+static int cv_remaining(const struct timespec *abstime, struct timespec *rel)
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+
+	rel->tv_sec  = abstime->tv_sec - now.tv_sec;
+	rel->tv_nsec = abstime->tv_nsec - now.tv_nsec;
+
+	if (rel->tv_nsec < 0) {
+		--rel->tv_sec;
+		rel->tv_nsec += 1000000000;
+	}
+
+	if (rel->tv_sec < 0) {
+		rel->tv_sec  = 0;
+		rel->tv_nsec = 0;
+		return 0;
+	}
+
+	return rel->tv_sec || rel->tv_nsec;
+}
+
+
+// a process that didn't inherit the handler from whoever called
+// cv_init() would otherwise be killed by its first wakeup
+void cv_attach(struct cv *cv)
+{
+	(void) cv;
 
 	struct sigaction act = {
 		.sa_handler = cv_sigusr1_handler,
@@ -48,57 +172,138 @@ void cv_init(struct cv *cv)
 	sigaction(SIGUSR1, &act, NULL);
 }
 
-int cv_signal(struct cv *cv)
+void cv_broadcast(struct cv *cv)
 {
+	STAT_INC(cv->stats.broadcasts);
+
+	// drain the whole queue in one pass; a waiter we fail to signal
+	// is gone anyway, so there's nobody left to retry for
 	spinlock_lock(&cv->lock);
 
-	if (!cv->use) {
-		spinlock_unlock(&cv->lock);
-		return -1;
+	for (; cv->use; --cv->use) {
+		cv_wake(&cv->waiter[cv->head]);
+		cv->head = (cv->head + 1) % CV_MAXPROC;
 	}
 
-	if (kill(cv->pid[cv->head], SIGUSR1) < 0) {
-		spinlock_unlock(&cv->lock);
-		return -1;
-	}
+	spinlock_unlock(&cv->lock);
+}
+
+void cv_init(struct cv *cv)
+{
+	memset(cv, 0, sizeof(*cv));
+	cv_attach(cv);
+}
 
-	--cv->use;
+int cv_signal(struct cv *cv)
+{
+	int ret = -1;
 
-	cv->head = (cv->head + 1) % CV_MAXPROC;
+	STAT_INC(cv->stats.signals);
+
+	spinlock_lock(&cv->lock);
+
+	// a waiter that exited while queued would otherwise wedge the head
+	// of the queue, so skip past it to the next one
+	while (cv->use && ret < 0) {
+		ret = cv_wake(&cv->waiter[cv->head]);
+
+		--cv->use;
+		cv->head = (cv->head + 1) % CV_MAXPROC;
+	}
 
 	spinlock_unlock(&cv->lock);
-	return 0;
+	return ret;
 }
 
-int cv_wait(struct cv *cv, struct spinlock *mutex)
+int cv_timedwait(
+	struct cv             *cv,
+	struct spinlock       *mutex,
+	const struct timespec *abstime)
 {
+	sigset_t        mask;
+	sigset_t        oldmask;
+	struct timespec rel;
+	unsigned long   start = STAT_CLOCK();
+
+	STAT_INC(cv->stats.waits);
+
+	sigemptyset(&mask);
+	sigaddset(&mask, SIGUSR1);
+
+	// block the wakeup before we're visible to cv_signal() so that it
+	// stays pending until sigtimedwait() rather than being lost
+	pthread_sigmask(SIG_BLOCK, &mask, &oldmask);
+
 	spinlock_lock(&cv->lock);
 
+	// no room to queue: back off with the mutex dropped so callers
+	// looping on their condition don't spin with it held
 	if (cv->use >= CV_MAXPROC) {
+		STAT_INC(cv->stats.overflows);
+
 		spinlock_unlock(&cv->lock);
+		pthread_sigmask(SIG_SETMASK, &oldmask, NULL);
+
+		spinlock_unlock(mutex);
+		sched_yield();
+		spinlock_lock(mutex);
+
+		errno = (abstime && !cv_remaining(abstime, &rel))
+			? ETIMEDOUT
+			: EAGAIN;
 		return -1;
 	}
 
 	++cv->use;
 
-	cv->pid[cv->tail++] = getpid();
+	struct cv_waiter self = cv_self();
+
+	cv->waiter[cv->tail++] = self;
 	cv->tail %= CV_MAXPROC;
 
 	spinlock_unlock(&cv->lock);
 
-	sigset_t mask;
-	sigset_t oldmask;
+	spinlock_unlock(mutex);
 
-	sigemptyset(&mask);
-	sigaddset(&mask, SIGUSR1);
+	int ret = 0;
 
-	sigprocmask(SIG_BLOCK, &mask, &oldmask);
+	for (;;) {
+		struct timespec *timeout = NULL;
+
+		if (abstime) {
+			cv_remaining(abstime, &rel);
+			timeout = &rel;
+		}
+
+		if (sigtimedwait(&mask, NULL, timeout) == SIGUSR1) break;
+		if (errno == EINTR) continue;
+
+		// cv_signal() sends its signal with cv->lock held, so if
+		// we're no longer queued the wakeup is already pending
+		spinlock_lock(&cv->lock);
+		int queued = cv_dequeue(cv, self.tid);
+		spinlock_unlock(&cv->lock);
+
+		if (queued) ret = -1;
+		else sigwaitinfo(&mask, NULL);
+
+		break;
+	}
+
+	STAT_ADD(cv->stats.wait_ns, STAT_CLOCK() - start);
 
-	spinlock_unlock(mutex);
-	sigsuspend(&oldmask);
 	spinlock_lock(mutex);
 
-	sigprocmask(SIG_UNBLOCK, &mask, NULL);
+	pthread_sigmask(SIG_SETMASK, &oldmask, NULL);
 
-	return 0;
+	if (ret < 0) errno = ETIMEDOUT;
+
+	return ret;
 }
+
+int cv_wait(struct cv *cv, struct spinlock *mutex)
+{
+	return cv_timedwait(cv, mutex, NULL);
+}
+
+#endif /* CV_FUTEX */
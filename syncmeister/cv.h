@@ -22,25 +22,60 @@
 
 #include <stddef.h>
 #include <sys/types.h>
+#include <time.h>
 
 #include "spinlock.h"
+#include "stats.h"
 
+#ifdef CV_FUTEX
+#include "ec.h"
+#endif
 
+
+// waiters the signal backend can queue; any more fall back to yielding
 #define CV_MAXPROC 64
 
 
+// the signal backend wakes individual threads, so a waiter is named by
+// its thread id together with the process it belongs to
+struct cv_waiter {
+	pid_t tgid;
+	pid_t tid;
+};
+
+
+#ifdef CV_FUTEX
+struct cv {
+	struct ec ec;
+#ifdef SYNCMEISTER_STATS
+	struct cv_stats stats;
+#endif
+};
+#else
 struct cv {
 	size_t          head;
 	size_t          tail;
 	size_t          use;
-	struct spinlock lock;
-	pid_t           pid[CV_MAXPROC];
+	struct spinlock  lock;
+	struct cv_waiter waiter[CV_MAXPROC];
+#ifdef SYNCMEISTER_STATS
+	struct cv_stats stats;
+#endif
 };
+#endif
 
 
+// cv_timedwait() takes an absolute CLOCK_MONOTONIC deadline and fails
+// with ETIMEDOUT once it passes; like cv_wait(), it may also return
+// early, so callers re-check their condition either way
+void cv_attach(struct cv *cv);
 void cv_broadcast(struct cv *cv);
 void cv_init(struct cv *cv);
 int  cv_signal(struct cv *cv);
+int  cv_timedwait(
+	struct cv             *cv,
+	struct spinlock       *mutex,
+	const struct timespec *abstime);
 int  cv_wait(struct cv *cv, struct spinlock *mutex);
 
 
@@ -0,0 +1,85 @@
+/*
+ * ec.c -- futex eventcounts
+ * Copyright (C) 2022  Jacob Koziej <jacobkoziej@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "ec.h"
+
+#include <stdatomic.h>
+#include <string.h>
+#include <time.h>
+
+#include "futex.h"
+
+
+void ec_cancel(struct ec *ec)
+{
+	atomic_fetch_sub(&ec->waiters, 1);
+}
+
+void ec_init(struct ec *ec)
+{
+	memset(ec, 0, sizeof(*ec));
+}
+
+int ec_notify(struct ec *ec, int n)
+{
+	// pairs with the fence in ec_prepare(): either the waiter sees
+	// our change when it re-checks, or we see it registered here
+	atomic_thread_fence(memory_order_seq_cst);
+
+	// nobody is parked, so skip the system call
+	if (!atomic_load_explicit(&ec->waiters, memory_order_relaxed))
+		return -1;
+
+	atomic_fetch_add(&ec->seq, 1);
+
+	// we deregister whoever we actually woke so that later notifiers
+	// don't pay for another system call before they get to run
+	int woken = futex_wake(&ec->seq, n);
+	if (woken > 0) atomic_fetch_sub(&ec->waiters, woken);
+
+	return (woken < 0) ? -1 : 0;
+}
+
+unsigned int ec_prepare(struct ec *ec)
+{
+	atomic_fetch_add(&ec->waiters, 1);
+	atomic_thread_fence(memory_order_seq_cst);
+
+	return atomic_load(&ec->seq);
+}
+
+int ec_timedwait(
+	struct ec             *ec,
+	unsigned int           key,
+	const struct timespec *abstime)
+{
+	// any ec_notify() since ec_prepare() bumped the sequence word,
+	// which makes FUTEX_WAIT return immediately instead of sleeping;
+	// only a real wakeup was accounted for by the notifier
+	if (futex_timedwait(&ec->seq, key, abstime) < 0) {
+		atomic_fetch_sub(&ec->waiters, 1);
+		return -1;
+	}
+
+	return 0;
+}
+
+void ec_wait(struct ec *ec, unsigned int key)
+{
+	ec_timedwait(ec, key, NULL);
+}
@@ -0,0 +1,47 @@
+/*
+ * ec.h -- futex eventcounts
+ * Copyright (C) 2022  Jacob Koziej <jacobkoziej@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef EC_H
+#define EC_H
+
+
+#include <stdatomic.h>
+#include <time.h>
+
+
+// a waiter calls ec_prepare(), re-checks its condition, and then
+// either ec_cancel()s or ec_wait()s on the returned key; a notifier
+// publishes its change before calling ec_notify()
+struct ec {
+	atomic_uint seq;
+	atomic_uint waiters;
+};
+
+
+void         ec_cancel(struct ec *ec);
+void         ec_init(struct ec *ec);
+int          ec_notify(struct ec *ec, int n);
+unsigned int ec_prepare(struct ec *ec);
+int          ec_timedwait(
+	struct ec             *ec,
+	unsigned int           key,
+	const struct timespec *abstime);
+void         ec_wait(struct ec *ec, unsigned int key);
+
+
+#endif /* EC_H */
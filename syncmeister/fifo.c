@@ -18,52 +18,400 @@
 
 #include "fifo.h"
 
+#include <errno.h>
+#include <fcntl.h>
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
 #include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
 
 #include "cv.h"
 #include "spinlock.h"
+#include "stats.h"
 
 
-void fifo_init(struct fifo *fifo)
+static struct fifo *fifo_map(int fd, size_t len)
+{
+	struct fifo *fifo = mmap(
+		NULL,
+		len,
+		PROT_READ | PROT_WRITE,
+		MAP_SHARED | ((fd < 0) ? MAP_ANONYMOUS : 0),
+		fd,
+		0);
+
+	return (fifo == MAP_FAILED) ? NULL : fifo;
+}
+
+static void fifo_event(struct fifo *fifo)
+{
+	uint64_t one = 1;
+
+	if (fifo->efd < 0) return;
+
+	// a saturated counter is still readable and a bad descriptor is
+	// the caller's to sort out, so only an interrupted write is worth
+	// another go
+	while (write(fifo->efd, &one, sizeof(one)) < 0 && errno == EINTR)
+		continue;
+}
+
+static unsigned long fifo_pop(struct fifo *fifo)
+{
+	--fifo->use;
+	STAT_INC(fifo->stats.reads);
+
+	unsigned long val = fifo->fifo[fifo->head++];
+
+	fifo->head %= fifo->size;
+
+	cv_signal(&fifo->full);
+
+	return val;
+}
+
+// returns whether the queue just went non-empty
+static int fifo_push(struct fifo *fifo, unsigned long val)
+{
+	++fifo->use;
+	STAT_INC(fifo->stats.writes);
+
+	fifo->fifo[fifo->tail] = val;
+
+	fifo->tail = (fifo->tail + 1) % fifo->size;
+
+	cv_signal(&fifo->empty);
+
+	return fifo->use == 1;
+}
+
+// both wait with the mutex held until there's something to read (or
+// room to write), giving up with ETIMEDOUT at abstime if there is one
+static int fifo_wait_rd(struct fifo *fifo, const struct timespec *abstime)
+{
+	if (fifo->use) return 0;
+
+	unsigned long start = STAT_CLOCK();
+	int           ret   = 0;
+
+	STAT_INC(fifo->stats.empty);
+
+	while (!fifo->use)
+		if (cv_timedwait(&fifo->empty, &fifo->mutex, abstime) < 0
+			&& errno == ETIMEDOUT
+			&& !fifo->use) {
+			ret = -1;
+			break;
+		}
+
+	STAT_ADD(fifo->stats.wait_ns, STAT_CLOCK() - start);
+
+	if (ret < 0) errno = ETIMEDOUT;
+
+	return ret;
+}
+
+static int fifo_wait_wr(struct fifo *fifo, const struct timespec *abstime)
+{
+	if (fifo->use < fifo->size) return 0;
+
+	unsigned long start = STAT_CLOCK();
+	int           ret   = 0;
+
+	STAT_INC(fifo->stats.full);
+
+	while (fifo->use >= fifo->size)
+		if (cv_timedwait(&fifo->full, &fifo->mutex, abstime) < 0
+			&& errno == ETIMEDOUT
+			&& fifo->use >= fifo->size) {
+			ret = -1;
+			break;
+		}
+
+	STAT_ADD(fifo->stats.wait_ns, STAT_CLOCK() - start);
+
+	if (ret < 0) errno = ETIMEDOUT;
+
+	return ret;
+}
+
+
+struct fifo *fifo_attach(const char *name)
+{
+	int fd = shm_open(name, O_RDWR, 0);
+	if (fd < 0) return NULL;
+
+	struct stat st;
+	if (fstat(fd, &st) < 0) goto error;
+
+	if ((size_t) st.st_size < sizeof(struct fifo)) {
+		errno = EAGAIN;
+		goto error;
+	}
+
+	struct fifo *fifo = fifo_map(fd, st.st_size);
+	if (!fifo) goto error;
+
+	close(fd);
+
+	if (!atomic_load_explicit(&fifo->ready, memory_order_acquire)
+		|| fifo->size > FIFO_SIZEMAX
+		|| FIFO_SIZEOF(fifo->size) > (size_t) st.st_size) {
+		munmap(fifo, st.st_size);
+		errno = EAGAIN;
+		return NULL;
+	}
+
+	cv_attach(&fifo->full);
+	cv_attach(&fifo->empty);
+
+	return fifo;
+
+error:
+	close(fd);
+
+	return NULL;
+}
+
+struct fifo *fifo_create(const char *name, size_t size)
+{
+	if (!size || size > FIFO_SIZEMAX) {
+		errno = EINVAL;
+		return NULL;
+	}
+
+	// anonymous queues are only shared with children forked later
+	if (!name) {
+		struct fifo *fifo = fifo_map(-1, FIFO_SIZEOF(size));
+		if (fifo) fifo_init(fifo, size);
+
+		return fifo;
+	}
+
+	int fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600);
+	if (fd < 0) return NULL;
+
+	if (ftruncate(fd, FIFO_SIZEOF(size)) < 0) goto error;
+
+	struct fifo *fifo = fifo_map(fd, FIFO_SIZEOF(size));
+	if (!fifo) goto error;
+
+	close(fd);
+
+	fifo_init(fifo, size);
+
+	return fifo;
+
+error:
+	close(fd);
+	shm_unlink(name);
+
+	return NULL;
+}
+
+int fifo_destroy(struct fifo *fifo)
+{
+	return munmap(fifo, FIFO_SIZEOF(fifo->size));
+}
+
+void fifo_init(struct fifo *fifo, size_t size)
 {
 	memset(fifo, 0, sizeof(*fifo));
+	fifo->size = size;
+	fifo->efd  = -1;
 	cv_init(&fifo->full);
 	cv_init(&fifo->empty);
+
+	atomic_store_explicit(&fifo->ready, 1, memory_order_release);
 }
 
 unsigned long fifo_rd(struct fifo *fifo)
 {
 	spinlock_lock(&fifo->mutex);
 
-	while (!fifo->use)
-		cv_wait(&fifo->empty, &fifo->mutex);
+	fifo_wait_rd(fifo, NULL);
 
-	--fifo->use;
+	unsigned long val = fifo_pop(fifo);
 
-	unsigned long val = fifo->fifo[fifo->head++];
+	spinlock_unlock(&fifo->mutex);
+
+	return val;
+}
+
+size_t fifo_rd_n(struct fifo *fifo, unsigned long *val, size_t n)
+{
+	if (!n) return 0;
+
+	spinlock_lock(&fifo->mutex);
+
+	fifo_wait_rd(fifo, NULL);
+
+	if (n > fifo->use) n = fifo->use;
+
+	// copy out in at most two runs around the end of the ring
+	size_t run = fifo->size - fifo->head;
+	if (run > n) run = n;
 
-	fifo->head %= FIFO_BUFSIZ;
+	memcpy(val, &fifo->fifo[fifo->head], run * sizeof(*val));
+	memcpy(val + run, fifo->fifo, (n - run) * sizeof(*val));
 
+	fifo->use  -= n;
+	fifo->head  = (fifo->head + n) % fifo->size;
+
+	STAT_ADD(fifo->stats.reads, n);
+
+	// a single wakeup per batch: the woken writer passes it on if
+	// there's still room, and likewise for readers below
 	cv_signal(&fifo->full);
+	if (fifo->use) cv_signal(&fifo->empty);
 
 	spinlock_unlock(&fifo->mutex);
 
-	return val;
+	return n;
+}
+
+int fifo_rd_timeout(
+	struct fifo           *fifo,
+	unsigned long         *val,
+	const struct timespec *abstime)
+{
+	spinlock_lock(&fifo->mutex);
+
+	if (fifo_wait_rd(fifo, abstime) < 0) {
+		spinlock_unlock(&fifo->mutex);
+		errno = ETIMEDOUT;
+		return -1;
+	}
+
+	*val = fifo_pop(fifo);
+
+	spinlock_unlock(&fifo->mutex);
+
+	return 0;
+}
+
+void fifo_set_eventfd(struct fifo *fifo, int efd)
+{
+	spinlock_lock(&fifo->mutex);
+
+	fifo->efd = efd;
+	int event = fifo->use != 0;
+
+	spinlock_unlock(&fifo->mutex);
+
+	// already non-empty, so there won't be a transition to report
+	if (event) fifo_event(fifo);
+}
+
+int fifo_try_rd(struct fifo *fifo, unsigned long *val)
+{
+	spinlock_lock(&fifo->mutex);
+
+	if (!fifo->use) {
+		spinlock_unlock(&fifo->mutex);
+		errno = EAGAIN;
+		return -1;
+	}
+
+	*val = fifo_pop(fifo);
+
+	spinlock_unlock(&fifo->mutex);
+
+	return 0;
+}
+
+int fifo_try_wr(struct fifo *fifo, unsigned long val)
+{
+	spinlock_lock(&fifo->mutex);
+
+	if (fifo->use >= fifo->size) {
+		spinlock_unlock(&fifo->mutex);
+		errno = EAGAIN;
+		return -1;
+	}
+
+	int event = fifo_push(fifo, val);
+
+	spinlock_unlock(&fifo->mutex);
+
+	if (event) fifo_event(fifo);
+
+	return 0;
+}
+
+int fifo_unlink(const char *name)
+{
+	return shm_unlink(name);
 }
 
 void fifo_wr(struct fifo *fifo, unsigned long val)
 {
 	spinlock_lock(&fifo->mutex);
 
-	while (fifo->use >= FIFO_BUFSIZ)
-		cv_wait(&fifo->full, &fifo->mutex);
+	fifo_wait_wr(fifo, NULL);
 
-	++fifo->use;
+	int event = fifo_push(fifo, val);
 
-	fifo->fifo[fifo->tail] = val;
+	spinlock_unlock(&fifo->mutex);
+
+	if (event) fifo_event(fifo);
+}
+
+size_t fifo_wr_n(struct fifo *fifo, const unsigned long *val, size_t n)
+{
+	if (!n) return 0;
+
+	spinlock_lock(&fifo->mutex);
+
+	fifo_wait_wr(fifo, NULL);
+
+	if (n > fifo->size - fifo->use) n = fifo->size - fifo->use;
+
+	size_t run = fifo->size - fifo->tail;
+	if (run > n) run = n;
+
+	memcpy(&fifo->fifo[fifo->tail], val, run * sizeof(*val));
+	memcpy(fifo->fifo, val + run, (n - run) * sizeof(*val));
 
-	fifo->tail = (fifo->tail + 1) % FIFO_BUFSIZ;
+	fifo->use  += n;
+	fifo->tail  = (fifo->tail + n) % fifo->size;
+
+	STAT_ADD(fifo->stats.writes, n);
+
+	int event = fifo->use == n;
 
 	cv_signal(&fifo->empty);
+	if (fifo->use < fifo->size) cv_signal(&fifo->full);
+
+	spinlock_unlock(&fifo->mutex);
+
+	if (event) fifo_event(fifo);
+
+	return n;
+}
+
+int fifo_wr_timeout(
+	struct fifo           *fifo,
+	unsigned long          val,
+	const struct timespec *abstime)
+{
+	spinlock_lock(&fifo->mutex);
+
+	if (fifo_wait_wr(fifo, abstime) < 0) {
+		spinlock_unlock(&fifo->mutex);
+		errno = ETIMEDOUT;
+		return -1;
+	}
+
+	int event = fifo_push(fifo, val);
+
 	spinlock_unlock(&fifo->mutex);
+
+	if (event) fifo_event(fifo);
+
+	return 0;
 }
@@ -20,29 +20,72 @@
 #define FIFO_H
 
 
+#include <stdatomic.h>
 #include <stddef.h>
+#include <stdint.h>
+#include <time.h>
 
 #include "cv.h"
 #include "spinlock.h"
+#include "stats.h"
 
 
 #define FIFO_BUFSIZ (1 << 10)
 
+#define FIFO_SIZEOF(size) \
+	(sizeof(struct fifo) + (size) * sizeof(((struct fifo *) 0)->fifo[0]))
 
+// the largest size FIFO_SIZEOF() can cope with without overflowing
+#define FIFO_SIZEMAX \
+	((SIZE_MAX - sizeof(struct fifo)) / sizeof(((struct fifo *) 0)->fifo[0]))
+
+
+// ready is only set once a fifo_create()d queue has been initialized,
+// so fifo_attach() never sees a half-built one; efd is an optional
+// eventfd written to whenever the queue goes from empty to non-empty
 struct fifo {
 	size_t          head;
 	size_t          tail;
 	size_t          use;
+	size_t          size;
+	atomic_uint     ready;
+	int             efd;
 	struct cv       full;
 	struct cv       empty;
 	struct spinlock mutex;
-	unsigned long   fifo[FIFO_BUFSIZ];
+#ifdef SYNCMEISTER_STATS
+	struct fifo_stats stats;
+#endif
+	unsigned long   fifo[];
 };
 
 
-void          fifo_init(struct fifo *fifo);
+// the _timeout variants take an absolute CLOCK_MONOTONIC deadline and
+// fail with ETIMEDOUT, the _try variants fail with EAGAIN.  An eventfd
+// is just a number, so it has to be valid in every writer's process
+// (inherited over fork() or passed at the same number); a consumer
+// reads the eventfd before draining with fifo_try_rd() so as not to
+// miss the next transition.
+struct fifo  *fifo_attach(const char *name);
+struct fifo  *fifo_create(const char *name, size_t size);
+int           fifo_destroy(struct fifo *fifo);
+void          fifo_init(struct fifo *fifo, size_t size);
 unsigned long fifo_rd(struct fifo *fifo);
+size_t        fifo_rd_n(struct fifo *fifo, unsigned long *val, size_t n);
+int           fifo_rd_timeout(
+	struct fifo           *fifo,
+	unsigned long         *val,
+	const struct timespec *abstime);
+void          fifo_set_eventfd(struct fifo *fifo, int efd);
+int           fifo_try_rd(struct fifo *fifo, unsigned long *val);
+int           fifo_try_wr(struct fifo *fifo, unsigned long val);
+int           fifo_unlink(const char *name);
 void          fifo_wr(struct fifo *fifo, unsigned long val);
+size_t        fifo_wr_n(struct fifo *fifo, const unsigned long *val, size_t n);
+int           fifo_wr_timeout(
+	struct fifo           *fifo,
+	unsigned long          val,
+	const struct timespec *abstime);
 
 
 #endif /* FIFO_H */
@@ -0,0 +1,145 @@
+/*
+ * fifostat.c -- dump the counters of a named FIFO
+ * Copyright (C) 2022  Jacob Koziej <jacobkoziej@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "cv.h"
+#include "fifo.h"
+#include "spinlock.h"
+#include "stats.h"
+
+
+#ifdef SYNCMEISTER_STATS
+
+#define LOAD(stat) atomic_load_explicit(&(stat), memory_order_relaxed)
+
+
+// every counter is printed as its running total followed by how much
+// it moved since the previous sample
+static void show(const char *key, unsigned long now, unsigned long *prev)
+{
+	printf("  %-10s %14lu (+%lu)\n", key, now, now - *prev);
+	*prev = now;
+}
+
+static void show_ms(const char *key, unsigned long ns, unsigned long *prev)
+{
+	printf("  %-10s %14.3f (+%.3f) ms\n", key, ns / 1e6, (ns - *prev) / 1e6);
+	*prev = ns;
+}
+
+static void show_cv(const char *name, struct cv *cv, unsigned long *prev)
+{
+	printf("cv %s\n", name);
+	show("waits", LOAD(cv->stats.waits), &prev[0]);
+	show("signals", LOAD(cv->stats.signals), &prev[1]);
+	show("broadcasts", LOAD(cv->stats.broadcasts), &prev[2]);
+	show("overflows", LOAD(cv->stats.overflows), &prev[3]);
+	show_ms("wait", LOAD(cv->stats.wait_ns), &prev[4]);
+}
+
+#endif /* SYNCMEISTER_STATS */
+
+
+int main(int argc, char **argv)
+{
+#ifndef SYNCMEISTER_STATS
+	(void) argc;
+
+	fprintf(stderr, "%s: built without STATS=1\n", argv[0]);
+	return EXIT_FAILURE;
+#else
+	unsigned long interval = 1000;
+	unsigned long count    = 0;
+
+	int opt;
+	while ((opt = getopt(argc, argv, "i:n:")) != -1) {
+		switch (opt) {
+			case 'i':
+				interval = strtoul(optarg, NULL, 0);
+				break;
+
+			case 'n':
+				count = strtoul(optarg, NULL, 0);
+				break;
+
+			default:
+				return EXIT_FAILURE;
+		}
+	}
+
+	if (optind != argc - 1) {
+		fprintf(stderr, "usage: %s [-i ms] [-n count] name\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	// the layout has to match whatever built the queue, so both sides
+	// need the same STATS, CV and SPINLOCK settings
+	struct fifo *fifo = fifo_attach(argv[optind]);
+
+	if (!fifo) {
+		perror("failed to `fifo_attach()` fifo");
+		return EXIT_FAILURE;
+	}
+
+	unsigned long fifo_prev[5]  = {0};
+	unsigned long lock_prev[5]  = {0};
+	unsigned long full_prev[5]  = {0};
+	unsigned long empty_prev[5] = {0};
+
+	struct timespec nap = {
+		.tv_sec  = interval / 1000,
+		.tv_nsec = interval % 1000 * 1000000,
+	};
+
+	for (unsigned long i = 0; !count || i < count; i++) {
+		if (i) {
+			nanosleep(&nap, NULL);
+			putchar('\n');
+		}
+
+		// use is read without the lock, so it's only a snapshot
+		printf("fifo %s: %zu/%zu\n", argv[optind], fifo->use, fifo->size);
+		show("reads", LOAD(fifo->stats.reads), &fifo_prev[0]);
+		show("writes", LOAD(fifo->stats.writes), &fifo_prev[1]);
+		show("empty", LOAD(fifo->stats.empty), &fifo_prev[2]);
+		show("full", LOAD(fifo->stats.full), &fifo_prev[3]);
+		show_ms("wait", LOAD(fifo->stats.wait_ns), &fifo_prev[4]);
+
+		printf("lock\n");
+		show("acquired", LOAD(fifo->mutex.stats.acquired), &lock_prev[0]);
+		show("contended", LOAD(fifo->mutex.stats.contended), &lock_prev[1]);
+		show("fails", LOAD(fifo->mutex.stats.fails), &lock_prev[2]);
+		show("yields", LOAD(fifo->mutex.stats.yields), &lock_prev[3]);
+		show_ms("wait", LOAD(fifo->mutex.stats.wait_ns), &lock_prev[4]);
+
+		show_cv("full", &fifo->full, full_prev);
+		show_cv("empty", &fifo->empty, empty_prev);
+
+		fflush(stdout);
+	}
+
+	fifo_destroy(fifo);
+
+	return EXIT_SUCCESS;
+#endif /* SYNCMEISTER_STATS */
+}
@@ -0,0 +1,57 @@
+/*
+ * futex.c -- futex system call wrappers
+ * Copyright (C) 2022  Jacob Koziej <jacobkoziej@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "futex.h"
+
+#include <linux/futex.h>
+#include <stdatomic.h>
+#include <stddef.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+
+// we never pass FUTEX_PRIVATE_FLAG since our futex words live in
+// MAP_SHARED memory and are waited on by unrelated address spaces
+
+
+int futex_timedwait(
+	atomic_uint           *uaddr,
+	unsigned int           val,
+	const struct timespec *abstime)
+{
+	// unlike FUTEX_WAIT, the bitset variant takes an absolute timeout
+	return syscall(
+		SYS_futex,
+		uaddr,
+		FUTEX_WAIT_BITSET,
+		val,
+		abstime,
+		NULL,
+		FUTEX_BITSET_MATCH_ANY);
+}
+
+int futex_wait(atomic_uint *uaddr, unsigned int val)
+{
+	return syscall(SYS_futex, uaddr, FUTEX_WAIT, val, NULL, NULL, 0);
+}
+
+int futex_wake(atomic_uint *uaddr, int n)
+{
+	return syscall(SYS_futex, uaddr, FUTEX_WAKE, n, NULL, NULL, 0);
+}
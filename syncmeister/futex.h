@@ -0,0 +1,37 @@
+/*
+ * futex.h -- futex system call wrappers
+ * Copyright (C) 2022  Jacob Koziej <jacobkoziej@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef FUTEX_H
+#define FUTEX_H
+
+
+#include <stdatomic.h>
+#include <time.h>
+
+
+// futex_timedwait() takes an absolute CLOCK_MONOTONIC deadline, or
+// NULL to wait forever
+int futex_timedwait(
+	atomic_uint           *uaddr,
+	unsigned int           val,
+	const struct timespec *abstime);
+int futex_wait(atomic_uint *uaddr, unsigned int val);
+int futex_wake(atomic_uint *uaddr, int n);
+
+
+#endif /* FUTEX_H */
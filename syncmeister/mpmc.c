@@ -0,0 +1,152 @@
+/*
+ * mpmc.c -- multi-producer/multi-consumer FIFO
+ * Copyright (C) 2022  Jacob Koziej <jacobkoziej@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "mpmc.h"
+
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "ec.h"
+
+
+void mpmc_init(struct mpmc *mpmc)
+{
+	memset(mpmc, 0, sizeof(*mpmc));
+	ec_init(&mpmc->full);
+	ec_init(&mpmc->empty);
+
+	for (size_t i = 0; i < MPMC_BUFSIZ; i++)
+		atomic_init(&mpmc->slot[i].seq, i);
+}
+
+unsigned long mpmc_rd(struct mpmc *mpmc)
+{
+	unsigned long val;
+
+	while (mpmc_try_rd(mpmc, &val) < 0) {
+		unsigned int key = ec_prepare(&mpmc->empty);
+
+		if (!mpmc_try_rd(mpmc, &val)) {
+			ec_cancel(&mpmc->empty);
+			break;
+		}
+
+		ec_wait(&mpmc->empty, key);
+	}
+
+	ec_notify(&mpmc->full, 1);
+
+	return val;
+}
+
+int mpmc_try_rd(struct mpmc *mpmc, unsigned long *val)
+{
+	struct mpmc_slot *slot;
+	size_t            pos = atomic_load_explicit(
+		&mpmc->head,
+		memory_order_relaxed);
+
+	for (;;) {
+		slot = &mpmc->slot[pos % MPMC_BUFSIZ];
+
+		size_t   seq  = atomic_load_explicit(
+			&slot->seq,
+			memory_order_acquire);
+		intptr_t diff = (intptr_t) seq - (intptr_t) (pos + 1);
+
+		if (!diff) {
+			if (atomic_compare_exchange_weak_explicit(
+				&mpmc->head,
+				&pos,
+				pos + 1,
+				memory_order_relaxed,
+				memory_order_relaxed)) break;
+		} else if (diff < 0) {
+			return -1;
+		} else {
+			pos = atomic_load_explicit(
+				&mpmc->head,
+				memory_order_relaxed);
+		}
+	}
+
+	*val = slot->val;
+
+	atomic_store_explicit(
+		&slot->seq,
+		pos + MPMC_BUFSIZ,
+		memory_order_release);
+
+	return 0;
+}
+
+int mpmc_try_wr(struct mpmc *mpmc, unsigned long val)
+{
+	struct mpmc_slot *slot;
+	size_t            pos = atomic_load_explicit(
+		&mpmc->tail,
+		memory_order_relaxed);
+
+	for (;;) {
+		slot = &mpmc->slot[pos % MPMC_BUFSIZ];
+
+		size_t   seq  = atomic_load_explicit(
+			&slot->seq,
+			memory_order_acquire);
+		intptr_t diff = (intptr_t) seq - (intptr_t) pos;
+
+		if (!diff) {
+			if (atomic_compare_exchange_weak_explicit(
+				&mpmc->tail,
+				&pos,
+				pos + 1,
+				memory_order_relaxed,
+				memory_order_relaxed)) break;
+		} else if (diff < 0) {
+			return -1;
+		} else {
+			pos = atomic_load_explicit(
+				&mpmc->tail,
+				memory_order_relaxed);
+		}
+	}
+
+	slot->val = val;
+
+	atomic_store_explicit(&slot->seq, pos + 1, memory_order_release);
+
+	return 0;
+}
+
+void mpmc_wr(struct mpmc *mpmc, unsigned long val)
+{
+	while (mpmc_try_wr(mpmc, val) < 0) {
+		unsigned int key = ec_prepare(&mpmc->full);
+
+		if (!mpmc_try_wr(mpmc, val)) {
+			ec_cancel(&mpmc->full);
+			break;
+		}
+
+		ec_wait(&mpmc->full, key);
+	}
+
+	ec_notify(&mpmc->empty, 1);
+}
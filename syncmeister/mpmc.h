@@ -0,0 +1,57 @@
+/*
+ * mpmc.h -- multi-producer/multi-consumer FIFO
+ * Copyright (C) 2022  Jacob Koziej <jacobkoziej@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef MPMC_H
+#define MPMC_H
+
+
+#include <stdatomic.h>
+#include <stddef.h>
+
+#include "ec.h"
+
+
+// must be a power of two
+#define MPMC_BUFSIZ (1 << 10)
+
+
+// each slot's sequence number says whose turn it is: a producer may
+// fill it when seq equals its claimed position, a consumer may drain
+// it once seq is one past that position
+struct mpmc_slot {
+	atomic_size_t seq;
+	unsigned long val;
+};
+
+struct mpmc {
+	_Alignas(64) atomic_size_t head;
+	_Alignas(64) atomic_size_t tail;
+	_Alignas(64) struct ec     full;
+	_Alignas(64) struct ec     empty;
+	struct mpmc_slot           slot[MPMC_BUFSIZ];
+};
+
+
+void          mpmc_init(struct mpmc *mpmc);
+unsigned long mpmc_rd(struct mpmc *mpmc);
+int           mpmc_try_rd(struct mpmc *mpmc, unsigned long *val);
+int           mpmc_try_wr(struct mpmc *mpmc, unsigned long val);
+void          mpmc_wr(struct mpmc *mpmc, unsigned long val);
+
+
+#endif /* MPMC_H */
@@ -0,0 +1,262 @@
+/*
+ * msgq.c -- primitive message queue
+ * Copyright (C) 2022  Jacob Koziej <jacobkoziej@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "msgq.h"
+
+#include <errno.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/types.h>
+
+#include "cv.h"
+#include "spinlock.h"
+
+
+#define MSGQ_PAD SIZE_MAX
+
+#define MSGQ_ALIGN(len) \
+	(((len) + sizeof(struct msgq_hdr) - 1) & ~(sizeof(struct msgq_hdr) - 1))
+#define MSGQ_RECSIZ(len) (sizeof(struct msgq_hdr) + MSGQ_ALIGN(len))
+
+
+enum {
+	MSGQ_RESERVED,
+	MSGQ_COMMITTED,
+	MSGQ_CLAIMED,
+	MSGQ_RELEASED,
+};
+
+
+static struct msgq_hdr *msgq_hdr(struct msgq *msgq, size_t off)
+{
+	return (struct msgq_hdr *) &msgq->buf[off];
+}
+
+// returns the record at the read cursor once it's been committed
+static struct msgq_hdr *msgq_ready(struct msgq *msgq)
+{
+	if (!msgq->unread) return NULL;
+
+	struct msgq_hdr *hdr = msgq_hdr(msgq, msgq->rd);
+
+	if (hdr->len == MSGQ_PAD) {
+		msgq->unread -= MSGQ_BUFSIZ - msgq->rd;
+		msgq->rd      = 0;
+
+		hdr = msgq_hdr(msgq, msgq->rd);
+	}
+
+	return (hdr->state == MSGQ_COMMITTED) ? hdr : NULL;
+}
+
+static void msgq_claim(struct msgq *msgq, struct msgq_hdr *hdr)
+{
+	hdr->state = MSGQ_CLAIMED;
+
+	msgq->unread -= MSGQ_RECSIZ(hdr->len);
+	msgq->rd      = (msgq->rd + MSGQ_RECSIZ(hdr->len)) % MSGQ_BUFSIZ;
+
+	// the record behind us may have been committed while we waited
+	// on this one, in which case nobody else was told about it
+	if (msgq_ready(msgq)) cv_signal(&msgq->empty);
+}
+
+// returns where a record of recsiz bytes can go, or -1 if it can't yet
+static ssize_t msgq_place(struct msgq *msgq, size_t recsiz)
+{
+	// an empty ring can restart at the front, which is what lets a
+	// record use the whole buffer
+	if (!msgq->use) msgq->head = msgq->rd = msgq->tail = 0;
+
+	if (msgq->use >= MSGQ_BUFSIZ) return -1;
+
+	if (msgq->tail < msgq->head)
+		return (msgq->head - msgq->tail >= recsiz) ? (ssize_t) msgq->tail : -1;
+
+	if (MSGQ_BUFSIZ - msgq->tail >= recsiz) return msgq->tail;
+
+	return (msgq->head >= recsiz) ? 0 : -1;
+}
+
+static void msgq_free(struct msgq *msgq, struct msgq_hdr *hdr)
+{
+	hdr->state = MSGQ_RELEASED;
+
+	// consumers may release out of order, so only the released prefix
+	// of the claimed records goes back to the producers
+	size_t freed = 0;
+
+	while (msgq->use > msgq->unread) {
+		hdr = msgq_hdr(msgq, msgq->head);
+
+		if (hdr->len == MSGQ_PAD) {
+			freed      += MSGQ_BUFSIZ - msgq->head;
+			msgq->use  -= MSGQ_BUFSIZ - msgq->head;
+			msgq->head  = 0;
+			continue;
+		}
+
+		if (hdr->state != MSGQ_RELEASED) break;
+
+		freed      += MSGQ_RECSIZ(hdr->len);
+		msgq->use  -= MSGQ_RECSIZ(hdr->len);
+		msgq->head  = (msgq->head + MSGQ_RECSIZ(hdr->len)) % MSGQ_BUFSIZ;
+	}
+
+	// producers wait on different amounts of room, and the one a
+	// signal picks may still not fit while a smaller one behind it
+	// would, so everyone gets to look
+	if (freed) cv_broadcast(&msgq->full);
+}
+
+static struct msgq_hdr *msgq_alloc(struct msgq *msgq, size_t len)
+{
+	size_t recsiz = MSGQ_RECSIZ(len);
+
+	ssize_t off;
+	while ((off = msgq_place(msgq, recsiz)) < 0)
+		cv_wait(&msgq->full, &msgq->mutex);
+
+	if ((size_t) off != msgq->tail) {
+		msgq_hdr(msgq, msgq->tail)->len = MSGQ_PAD;
+
+		msgq->use    += MSGQ_BUFSIZ - msgq->tail;
+		msgq->unread += MSGQ_BUFSIZ - msgq->tail;
+	}
+
+	struct msgq_hdr *hdr = msgq_hdr(msgq, off);
+
+	hdr->len   = len;
+	hdr->state = MSGQ_RESERVED;
+
+	msgq->use    += recsiz;
+	msgq->unread += recsiz;
+	msgq->tail    = (off + recsiz) % MSGQ_BUFSIZ;
+
+	return hdr;
+}
+
+
+void msgq_commit(struct msgq *msgq, void *msg)
+{
+	struct msgq_hdr *hdr = (struct msgq_hdr *) msg - 1;
+
+	spinlock_lock(&msgq->mutex);
+
+	hdr->state = MSGQ_COMMITTED;
+
+	// producers can commit out of order, but only the record at the
+	// read cursor is of any use to a waiting consumer
+	if (msgq_ready(msgq) == hdr) cv_signal(&msgq->empty);
+
+	spinlock_unlock(&msgq->mutex);
+}
+
+void msgq_init(struct msgq *msgq)
+{
+	memset(msgq, 0, sizeof(*msgq));
+	cv_init(&msgq->full);
+	cv_init(&msgq->empty);
+}
+
+void *msgq_peek(struct msgq *msgq, size_t *len)
+{
+	struct msgq_hdr *hdr;
+
+	spinlock_lock(&msgq->mutex);
+
+	while (!(hdr = msgq_ready(msgq)))
+		cv_wait(&msgq->empty, &msgq->mutex);
+
+	msgq_claim(msgq, hdr);
+
+	spinlock_unlock(&msgq->mutex);
+
+	*len = hdr->len;
+	return hdr + 1;
+}
+
+ssize_t msgq_recv(struct msgq *msgq, void *buf, size_t len)
+{
+	struct msgq_hdr *hdr;
+
+	spinlock_lock(&msgq->mutex);
+
+	while (!(hdr = msgq_ready(msgq)))
+		cv_wait(&msgq->empty, &msgq->mutex);
+
+	// leave the record queued so the caller can retry with room
+	if (hdr->len > len) {
+		spinlock_unlock(&msgq->mutex);
+		errno = EMSGSIZE;
+		return -1;
+	}
+
+	len = hdr->len;
+	memcpy(buf, hdr + 1, len);
+
+	msgq_claim(msgq, hdr);
+	msgq_free(msgq, hdr);
+
+	spinlock_unlock(&msgq->mutex);
+
+	return len;
+}
+
+void msgq_release(struct msgq *msgq, void *msg)
+{
+	spinlock_lock(&msgq->mutex);
+	msgq_free(msgq, (struct msgq_hdr *) msg - 1);
+	spinlock_unlock(&msgq->mutex);
+}
+
+void *msgq_reserve(struct msgq *msgq, size_t len)
+{
+	if (len > MSGQ_MSGMAX) {
+		errno = EMSGSIZE;
+		return NULL;
+	}
+
+	spinlock_lock(&msgq->mutex);
+	struct msgq_hdr *hdr = msgq_alloc(msgq, len);
+	spinlock_unlock(&msgq->mutex);
+
+	return hdr + 1;
+}
+
+int msgq_send(struct msgq *msgq, const void *buf, size_t len)
+{
+	if (len > MSGQ_MSGMAX) {
+		errno = EMSGSIZE;
+		return -1;
+	}
+
+	spinlock_lock(&msgq->mutex);
+
+	struct msgq_hdr *hdr = msgq_alloc(msgq, len);
+
+	memcpy(hdr + 1, buf, len);
+	hdr->state = MSGQ_COMMITTED;
+
+	if (msgq_ready(msgq) == hdr) cv_signal(&msgq->empty);
+
+	spinlock_unlock(&msgq->mutex);
+
+	return 0;
+}
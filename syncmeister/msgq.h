@@ -0,0 +1,74 @@
+/*
+ * msgq.h -- primitive message queue
+ * Copyright (C) 2022  Jacob Koziej <jacobkoziej@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef MSGQ_H
+#define MSGQ_H
+
+
+#include <stddef.h>
+#include <sys/types.h>
+
+#include "cv.h"
+#include "spinlock.h"
+
+
+#define MSGQ_BUFSIZ (1 << 16)
+#define MSGQ_MSGMAX (MSGQ_BUFSIZ - sizeof(struct msgq_hdr))
+
+
+// records are a header followed by the payload, padded so the next
+// header stays aligned; a record that doesn't fit before the end of
+// the ring is preceded by a padding record covering the remainder
+struct msgq_hdr {
+	size_t len;
+	size_t state;
+};
+
+// records in [head, rd) have been claimed by consumers and [rd, tail)
+// have been reserved by producers; use and unread count the bytes in
+// [head, tail) and [rd, tail) since the offsets alone are ambiguous
+// once the ring fills
+struct msgq {
+	size_t          head;
+	size_t          rd;
+	size_t          tail;
+	size_t          use;
+	size_t          unread;
+	struct cv       full;
+	struct cv       empty;
+	struct spinlock mutex;
+	_Alignas(struct msgq_hdr) unsigned char buf[MSGQ_BUFSIZ];
+};
+
+
+// msgq_reserve() hands out space in place for a producer to fill and
+// msgq_commit(); msgq_peek() hands a consumer a committed record in
+// place until it calls msgq_release().  Records are delivered in the
+// order they were reserved regardless of commit order, so a producer
+// must not block in msgq_reserve() while sitting on an uncommitted
+// reservation of its own.
+void    msgq_commit(struct msgq *msgq, void *msg);
+void    msgq_init(struct msgq *msgq);
+void   *msgq_peek(struct msgq *msgq, size_t *len);
+ssize_t msgq_recv(struct msgq *msgq, void *buf, size_t len);
+void    msgq_release(struct msgq *msgq, void *msg);
+void   *msgq_reserve(struct msgq *msgq, size_t len);
+int     msgq_send(struct msgq *msgq, const void *buf, size_t len);
+
+
+#endif /* MSGQ_H */
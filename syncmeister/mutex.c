@@ -0,0 +1,107 @@
+/*
+ * mutex.c -- primitive adaptive mutex
+ * Copyright (C) 2022  Jacob Koziej <jacobkoziej@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "mutex.h"
+
+#include <errno.h>
+#include <stdatomic.h>
+#include <string.h>
+
+#include "futex.h"
+#include "tas.h"
+
+
+static int mutex_cas(struct mutex *mutex, unsigned int old, unsigned int new)
+{
+	return atomic_compare_exchange_strong_explicit(
+		&mutex->state,
+		&old,
+		new,
+		memory_order_acquire,
+		memory_order_relaxed);
+}
+
+// spin for up to twice what it's recently taken to get the lock, so
+// short critical sections are waited out without a system call
+static int mutex_spin(struct mutex *mutex)
+{
+	int spin = atomic_load_explicit(&mutex->spin, memory_order_relaxed);
+	int max  = spin * 2 + 16;
+	int cnt  = 0;
+
+	if (max > MUTEX_SPIN_MAX) max = MUTEX_SPIN_MAX;
+
+	int locked = 0;
+
+	while (cnt++ < max) {
+		cpu_relax();
+
+		if (atomic_load_explicit(&mutex->state, memory_order_relaxed)
+			== MUTEX_UNLOCKED && mutex_cas(mutex, MUTEX_UNLOCKED, MUTEX_LOCKED)) {
+			locked = 1;
+			break;
+		}
+	}
+
+	// racy on purpose since it's only a hint: a miss means the holder
+	// is in for the long haul, so next time we give up sooner
+	atomic_store_explicit(
+		&mutex->spin,
+		(locked) ? spin + (cnt - spin) / 8 : spin - spin / 8,
+		memory_order_relaxed);
+
+	return locked;
+}
+
+
+void mutex_init(struct mutex *mutex)
+{
+	memset(mutex, 0, sizeof(*mutex));
+}
+
+void mutex_lock(struct mutex *mutex)
+{
+	if (mutex_cas(mutex, MUTEX_UNLOCKED, MUTEX_LOCKED)) return;
+
+	if (mutex_spin(mutex)) return;
+
+	// we can't tell whether anybody else is parked, so assume so and
+	// leave it to our unlock to wake the next one
+	while (atomic_exchange_explicit(
+		&mutex->state,
+		MUTEX_CONTENDED,
+		memory_order_acquire) != MUTEX_UNLOCKED)
+		futex_wait(&mutex->state, MUTEX_CONTENDED);
+}
+
+int mutex_trylock(struct mutex *mutex)
+{
+	if (mutex_cas(mutex, MUTEX_UNLOCKED, MUTEX_LOCKED)) return 0;
+
+	errno = EBUSY;
+	return -1;
+}
+
+void mutex_unlock(struct mutex *mutex)
+{
+	if (atomic_exchange_explicit(
+		&mutex->state,
+		MUTEX_UNLOCKED,
+		memory_order_release) == MUTEX_CONTENDED)
+		futex_wake(&mutex->state, 1);
+}
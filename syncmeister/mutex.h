@@ -0,0 +1,54 @@
+/*
+ * mutex.h -- primitive adaptive mutex
+ * Copyright (C) 2022  Jacob Koziej <jacobkoziej@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef MUTEX_H
+#define MUTEX_H
+
+
+#include <stdatomic.h>
+
+
+// upper bound on the spins (in units of cpu_relax()) before parking
+#ifndef MUTEX_SPIN_MAX
+#define MUTEX_SPIN_MAX (1 << 10)
+#endif
+
+
+enum {
+	MUTEX_UNLOCKED,
+	MUTEX_LOCKED,
+	MUTEX_CONTENDED,
+};
+
+
+// state is MUTEX_CONTENDED whenever somebody may be parked on it, which
+// is the only time an unlock has to enter the kernel; spin is a moving
+// average of how long recent acquisitions spun before getting the lock
+struct mutex {
+	atomic_uint state;
+	atomic_int  spin;
+};
+
+
+void mutex_init(struct mutex *mutex);
+void mutex_lock(struct mutex *mutex);
+int  mutex_trylock(struct mutex *mutex);
+void mutex_unlock(struct mutex *mutex);
+
+
+#endif /* MUTEX_H */
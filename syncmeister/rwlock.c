@@ -0,0 +1,81 @@
+/*
+ * rwlock.c -- primitive reader-writer lock
+ * Copyright (C) 2022  Jacob Koziej <jacobkoziej@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "rwlock.h"
+
+#include <stdatomic.h>
+
+#include "spinlock.h"
+
+
+void rwlock_rdlock(struct rwlock *lock)
+{
+	unsigned long spins = 0;
+
+	for (;;) {
+		while (atomic_load_explicit(&lock->writers, memory_order_relaxed)
+			|| (atomic_load_explicit(&lock->state, memory_order_relaxed)
+				& RWLOCK_WRITER))
+			spinlock_relax(&spins);
+
+		unsigned int state = atomic_fetch_add_explicit(
+			&lock->state,
+			1,
+			memory_order_acquire);
+
+		// a writer got in between our check and our increment
+		if (!(state & RWLOCK_WRITER)
+			&& !atomic_load_explicit(&lock->writers, memory_order_relaxed))
+			return;
+
+		atomic_fetch_sub_explicit(&lock->state, 1, memory_order_relaxed);
+	}
+}
+
+void rwlock_rdunlock(struct rwlock *lock)
+{
+	atomic_fetch_sub_explicit(&lock->state, 1, memory_order_release);
+}
+
+void rwlock_wrlock(struct rwlock *lock)
+{
+	unsigned long spins = 0;
+
+	atomic_fetch_add_explicit(&lock->writers, 1, memory_order_relaxed);
+
+	for (;;) {
+		unsigned int state = 0;
+
+		if (atomic_compare_exchange_weak_explicit(
+			&lock->state,
+			&state,
+			RWLOCK_WRITER,
+			memory_order_acquire,
+			memory_order_relaxed)) break;
+
+		spinlock_relax(&spins);
+	}
+
+	atomic_fetch_sub_explicit(&lock->writers, 1, memory_order_relaxed);
+}
+
+void rwlock_wrunlock(struct rwlock *lock)
+{
+	// readers backing off may still be passing through the count
+	atomic_fetch_sub_explicit(&lock->state, RWLOCK_WRITER, memory_order_release);
+}
@@ -0,0 +1,44 @@
+/*
+ * rwlock.h -- primitive reader-writer lock
+ * Copyright (C) 2022  Jacob Koziej <jacobkoziej@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef RWLOCK_H
+#define RWLOCK_H
+
+
+#include <stdatomic.h>
+
+
+#define RWLOCK_WRITER (1u << 31)
+
+
+// state holds the reader count plus RWLOCK_WRITER while a writer owns
+// the lock; readers stand aside whenever writers are queued up, which
+// is what gives writers preference
+struct rwlock {
+	atomic_uint state;
+	atomic_uint writers;
+};
+
+
+void rwlock_rdlock(struct rwlock *lock);
+void rwlock_rdunlock(struct rwlock *lock);
+void rwlock_wrlock(struct rwlock *lock);
+void rwlock_wrunlock(struct rwlock *lock);
+
+
+#endif /* RWLOCK_H */
@@ -0,0 +1,69 @@
+/*
+ * sema.c -- primitive counting semaphore
+ * Copyright (C) 2022  Jacob Koziej <jacobkoziej@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "sema.h"
+
+#include <errno.h>
+#include <stdatomic.h>
+
+#include "ec.h"
+
+
+void sema_init(struct sema *sema, unsigned int count)
+{
+	atomic_init(&sema->count, count);
+	ec_init(&sema->ec);
+}
+
+void sema_post(struct sema *sema)
+{
+	atomic_fetch_add_explicit(&sema->count, 1, memory_order_release);
+	ec_notify(&sema->ec, 1);
+}
+
+int sema_trywait(struct sema *sema)
+{
+	unsigned int count = atomic_load_explicit(
+		&sema->count,
+		memory_order_relaxed);
+
+	while (count)
+		if (atomic_compare_exchange_weak_explicit(
+			&sema->count,
+			&count,
+			count - 1,
+			memory_order_acquire,
+			memory_order_relaxed)) return 0;
+
+	errno = EAGAIN;
+	return -1;
+}
+
+void sema_wait(struct sema *sema)
+{
+	while (sema_trywait(sema) < 0) {
+		unsigned int key = ec_prepare(&sema->ec);
+
+		if (!sema_trywait(sema)) {
+			ec_cancel(&sema->ec);
+			break;
+		}
+
+		ec_wait(&sema->ec, key);
+	}
+}
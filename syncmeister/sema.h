@@ -0,0 +1,41 @@
+/*
+ * sema.h -- primitive counting semaphore
+ * Copyright (C) 2022  Jacob Koziej <jacobkoziej@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef SEMA_H
+#define SEMA_H
+
+
+#include <stdatomic.h>
+
+#include "ec.h"
+
+
+// named so as not to collide with the POSIX sem_*() in libc
+struct sema {
+	atomic_uint count;
+	struct ec   ec;
+};
+
+
+void sema_init(struct sema *sema, unsigned int count);
+void sema_post(struct sema *sema);
+int  sema_trywait(struct sema *sema);
+void sema_wait(struct sema *sema);
+
+
+#endif /* SEMA_H */
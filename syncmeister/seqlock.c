@@ -0,0 +1,83 @@
+/*
+ * seqlock.c -- primitive sequence lock
+ * Copyright (C) 2022  Jacob Koziej <jacobkoziej@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "seqlock.h"
+
+#include <stdatomic.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "spinlock.h"
+
+
+void seqlock_read(struct seqlock *sl, void *dst, const void *src, size_t n)
+{
+	unsigned int seq;
+
+	do {
+		seq = seqlock_read_begin(sl);
+		memcpy(dst, src, n);
+	} while (seqlock_read_retry(sl, seq));
+}
+
+unsigned int seqlock_read_begin(struct seqlock *sl)
+{
+	unsigned long spins = 0;
+	unsigned int  seq;
+
+	while ((seq = atomic_load_explicit(&sl->seq, memory_order_acquire)) & 1)
+		spinlock_relax(&spins);
+
+	return seq;
+}
+
+int seqlock_read_retry(struct seqlock *sl, unsigned int seq)
+{
+	// keep the reads of the protected data ahead of the recheck
+	atomic_thread_fence(memory_order_acquire);
+
+	return atomic_load_explicit(&sl->seq, memory_order_relaxed) != seq;
+}
+
+void seqlock_write(struct seqlock *sl, void *dst, const void *src, size_t n)
+{
+	seqlock_write_lock(sl);
+	memcpy(dst, src, n);
+	seqlock_write_unlock(sl);
+}
+
+void seqlock_write_lock(struct seqlock *sl)
+{
+	spinlock_lock(&sl->lock);
+
+	unsigned int seq = atomic_load_explicit(&sl->seq, memory_order_relaxed);
+
+	atomic_store_explicit(&sl->seq, seq + 1, memory_order_relaxed);
+
+	// keep the writes to the protected data behind the odd count
+	atomic_thread_fence(memory_order_release);
+}
+
+void seqlock_write_unlock(struct seqlock *sl)
+{
+	unsigned int seq = atomic_load_explicit(&sl->seq, memory_order_relaxed);
+
+	atomic_store_explicit(&sl->seq, seq + 1, memory_order_release);
+
+	spinlock_unlock(&sl->lock);
+}
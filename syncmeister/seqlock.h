@@ -0,0 +1,45 @@
+/*
+ * seqlock.h -- primitive sequence lock
+ * Copyright (C) 2022  Jacob Koziej <jacobkoziej@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef SEQLOCK_H
+#define SEQLOCK_H
+
+
+#include <stdatomic.h>
+#include <stddef.h>
+
+#include "spinlock.h"
+
+
+// seq is odd while a writer is mid-update; readers never block a
+// writer and simply retry if seq moved underneath them
+struct seqlock {
+	atomic_uint     seq;
+	struct spinlock lock;
+};
+
+
+void         seqlock_read(struct seqlock *sl, void *dst, const void *src, size_t n);
+unsigned int seqlock_read_begin(struct seqlock *sl);
+int          seqlock_read_retry(struct seqlock *sl, unsigned int seq);
+void         seqlock_write(struct seqlock *sl, void *dst, const void *src, size_t n);
+void         seqlock_write_lock(struct seqlock *sl);
+void         seqlock_write_unlock(struct seqlock *sl);
+
+
+#endif /* SEQLOCK_H */
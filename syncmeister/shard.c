@@ -0,0 +1,122 @@
+/*
+ * shard.c -- sharded FIFO with work stealing
+ * Copyright (C) 2022  Jacob Koziej <jacobkoziej@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "shard.h"
+
+#include <errno.h>
+#include <stdatomic.h>
+#include <stddef.h>
+#include <sys/mman.h>
+
+#include "ec.h"
+#include "fifo.h"
+
+
+static struct fifo *shard_fifo(struct shard *shard, size_t i)
+{
+	return (struct fifo *) &shard->fifo[i * shard->stride];
+}
+
+static void shard_put(struct shard *shard, size_t i, unsigned long val)
+{
+	fifo_wr(shard_fifo(shard, i), val);
+	ec_notify(&shard->ec, 1);
+}
+
+
+struct shard *shard_create(size_t nshards, size_t size)
+{
+	if (!nshards || !size) {
+		errno = EINVAL;
+		return NULL;
+	}
+
+	struct shard *shard = mmap(
+		NULL,
+		SHARD_SIZEOF(nshards, size),
+		PROT_READ | PROT_WRITE,
+		MAP_ANONYMOUS | MAP_SHARED,
+		-1,
+		0);
+
+	if (shard == MAP_FAILED) return NULL;
+
+	shard->nshards = nshards;
+	shard->stride  = SHARD_STRIDE(size);
+	ec_init(&shard->ec);
+
+	for (size_t i = 0; i < nshards; i++) fifo_init(shard_fifo(shard, i), size);
+
+	return shard;
+}
+
+int shard_destroy(struct shard *shard)
+{
+	return munmap(
+		shard,
+		sizeof(*shard) + shard->nshards * shard->stride);
+}
+
+unsigned long shard_rd(struct shard *shard, size_t self)
+{
+	unsigned long val;
+
+	while (shard_try_rd(shard, self, &val) < 0) {
+		unsigned int key = ec_prepare(&shard->ec);
+
+		if (!shard_try_rd(shard, self, &val)) {
+			ec_cancel(&shard->ec);
+			break;
+		}
+
+		ec_wait(&shard->ec, key);
+	}
+
+	return val;
+}
+
+int shard_try_rd(struct shard *shard, size_t self, unsigned long *val)
+{
+	// our own shard first, then steal from our neighbours in turn so
+	// idle consumers don't all pile onto the same victim
+	for (size_t i = 0; i < shard->nshards; i++)
+		if (!fifo_try_rd(
+			shard_fifo(shard, (self + i) % shard->nshards),
+			val)) return 0;
+
+	errno = EAGAIN;
+	return -1;
+}
+
+void shard_wr(struct shard *shard, unsigned long val)
+{
+	size_t i = atomic_fetch_add_explicit(
+		&shard->next,
+		1,
+		memory_order_relaxed);
+
+	shard_put(shard, i % shard->nshards, val);
+}
+
+void shard_wr_key(struct shard *shard, unsigned long key, unsigned long val)
+{
+	// fibonacci hashing, so sequential keys still land far apart
+	key *= 0x9e3779b97f4a7c15ul;
+
+	shard_put(shard, (key >> 32) % shard->nshards, val);
+}
@@ -0,0 +1,60 @@
+/*
+ * shard.h -- sharded FIFO with work stealing
+ * Copyright (C) 2022  Jacob Koziej <jacobkoziej@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef SHARD_H
+#define SHARD_H
+
+
+#include <stdatomic.h>
+#include <stddef.h>
+
+#include "ec.h"
+#include "fifo.h"
+
+
+#define SHARD_STRIDE(size) ((FIFO_SIZEOF(size) + 63) & ~(size_t) 63)
+#define SHARD_SIZEOF(nshards, size) \
+	(sizeof(struct shard) + (nshards) * SHARD_STRIDE(size))
+
+
+// one fifo per consumer laid out back to back after the header, each
+// on its own cache lines; consumers that find every shard empty sleep
+// on the shared eventcount rather than on any one fifo
+struct shard {
+	size_t                     nshards;
+	size_t                     stride;
+	_Alignas(64) atomic_size_t next;
+	_Alignas(64) struct ec     ec;
+	_Alignas(64) unsigned char fifo[];
+};
+
+
+// each shard is FIFO, so values written with the same key come out in
+// the order they went in, though not necessarily to the same consumer;
+// shard_wr() spreads values round-robin and makes no such promise.
+// Consumers pass their own index to start from their own shard before
+// stealing from the others.
+struct shard *shard_create(size_t nshards, size_t size);
+int           shard_destroy(struct shard *shard);
+unsigned long shard_rd(struct shard *shard, size_t self);
+int           shard_try_rd(struct shard *shard, size_t self, unsigned long *val);
+void          shard_wr(struct shard *shard, unsigned long val);
+void          shard_wr_key(struct shard *shard, unsigned long key, unsigned long val);
+
+
+#endif /* SHARD_H */
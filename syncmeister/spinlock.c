@@ -19,19 +19,242 @@
 #include "spinlock.h"
 
 #include <sched.h>
+#include <stdatomic.h>
+#include <sys/syscall.h>
 #include <unistd.h>
 
+#include "stats.h"
 #include "tas.h"
 
 
+#ifdef SYNCMEISTER_STATS
+static void spinlock_stat(
+	struct spinlock *lock,
+	unsigned long    fails,
+	unsigned long    yields,
+	unsigned long    start)
+{
+	STAT_INC(lock->stats.acquired);
+
+	if (!fails) return;
+
+	STAT_INC(lock->stats.contended);
+	STAT_ADD(lock->stats.fails, fails);
+	STAT_ADD(lock->stats.yields, yields);
+	STAT_ADD(lock->stats.wait_ns, stats_clock() - start);
+}
+#else
+#define spinlock_stat(lock, fails, yields, start) \
+	((void) (lock), (void) (fails), (void) (yields), (void) (start))
+#endif
+
+
+// returns whether we gave up the cpu
+int spinlock_relax(unsigned long *spins)
+{
+	cpu_relax();
+
+	if (++*spins >= SPINLOCK_SPIN_BUDGET) {
+		sched_yield();
+		*spins = 0;
+		return 1;
+	}
+
+	return 0;
+}
+
+
+#if defined(SPINLOCK_TICKET)
+
+void spinlock_lock(struct spinlock *lock)
+{
+	unsigned int  ticket = atomic_fetch_add_explicit(
+		&lock->next,
+		1,
+		memory_order_relaxed);
+	unsigned long spins  = 0;
+	unsigned long fails  = 0;
+	unsigned long yields = 0;
+	unsigned long start  = 0;
+
+	unsigned int owner;
+	while ((owner = atomic_load_explicit(
+		&lock->owner,
+		memory_order_acquire)) != ticket) {
+		if (!fails++) start = STAT_CLOCK();
+
+		// only the next ticket in line can make use of spinning
+		if (ticket - owner > 1) {
+			sched_yield();
+			++yields;
+		} else yields += spinlock_relax(&spins);
+	}
+
+	lock->pid = getpid();
+
+	spinlock_stat(lock, fails, yields, start);
+}
+
+void spinlock_unlock(struct spinlock *lock)
+{
+	unsigned int owner = atomic_load_explicit(
+		&lock->owner,
+		memory_order_relaxed);
+
+	atomic_store_explicit(&lock->owner, owner + 1, memory_order_release);
+}
+
+#elif defined(SPINLOCK_MCS)
+
+static unsigned int mcs_claim(struct spinlock *lock)
+{
+	unsigned long spins = 0;
+	unsigned int  slot  = syscall(SYS_gettid) % SPINLOCK_MCS_SLOTS;
+
+	// a thread normally finds its home slot free; probe onwards for
+	// tid collisions or nested acquisitions
+	for (;;) {
+		unsigned int busy = 0;
+
+		if (atomic_compare_exchange_weak_explicit(
+			&lock->node[slot].busy,
+			&busy,
+			1,
+			memory_order_acquire,
+			memory_order_relaxed)) return slot;
+
+		slot = (slot + 1) % SPINLOCK_MCS_SLOTS;
+		spinlock_relax(&spins);
+	}
+}
+
+void spinlock_lock(struct spinlock *lock)
+{
+	unsigned int     slot   = mcs_claim(lock);
+	struct mcs_node *node   = &lock->node[slot];
+	unsigned long    spins  = 0;
+	unsigned long    fails  = 0;
+	unsigned long    yields = 0;
+	unsigned long    start  = 0;
+
+	atomic_store_explicit(&node->next, 0, memory_order_relaxed);
+	atomic_store_explicit(&node->locked, 1, memory_order_relaxed);
+
+	unsigned int prev = atomic_exchange_explicit(
+		&lock->tail,
+		slot + 1,
+		memory_order_acq_rel);
+
+	if (prev) {
+		atomic_store_explicit(
+			&lock->node[prev - 1].next,
+			slot + 1,
+			memory_order_release);
+
+		start = STAT_CLOCK();
+
+		while (atomic_load_explicit(&node->locked, memory_order_acquire)) {
+			yields += spinlock_relax(&spins);
+			++fails;
+		}
+	}
+
+	lock->slot = slot;
+	lock->pid  = getpid();
+
+	spinlock_stat(lock, fails, yields, start);
+}
+
+void spinlock_unlock(struct spinlock *lock)
+{
+	unsigned int     slot  = lock->slot;
+	struct mcs_node *node  = &lock->node[slot];
+	unsigned long    spins = 0;
+
+	unsigned int next = atomic_load_explicit(&node->next, memory_order_acquire);
+
+	if (!next) {
+		unsigned int tail = slot + 1;
+
+		if (atomic_compare_exchange_strong_explicit(
+			&lock->tail,
+			&tail,
+			0,
+			memory_order_release,
+			memory_order_relaxed)) goto done;
+
+		// a successor swapped itself in but hasn't linked up yet
+		while (!(next = atomic_load_explicit(
+			&node->next,
+			memory_order_acquire))) spinlock_relax(&spins);
+	}
+
+	atomic_store_explicit(&lock->node[next - 1].locked, 0, memory_order_release);
+
+done:
+	atomic_store_explicit(&node->busy, 0, memory_order_release);
+}
+
+#elif defined(SPINLOCK_TTAS)
+
+void spinlock_lock(struct spinlock *lock)
+{
+	unsigned long backoff = 1;
+	unsigned long spins   = 0;
+	unsigned long fails   = 0;
+	unsigned long yields  = 0;
+	unsigned long start   = 0;
+
+	while (tas(&lock->lock)) {
+		if (!fails++) start = STAT_CLOCK();
+
+		// wait on a plain load so the cache line stays shared
+		// until the holder releases it
+		do {
+			for (unsigned long i = 0; i < backoff; i++) cpu_relax();
+
+			spins += backoff;
+			if (spins >= SPINLOCK_SPIN_BUDGET) {
+				sched_yield();
+				spins = 0;
+				++yields;
+			}
+
+			if (backoff < SPINLOCK_BACKOFF_MAX) backoff <<= 1;
+		} while (*(volatile char *) &lock->lock);
+	}
+
+	lock->pid = getpid();
+
+	spinlock_stat(lock, fails, yields, start);
+}
+
+void spinlock_unlock(struct spinlock *lock)
+{
+	lock->lock = 0;
+}
+
+#else
+
 void spinlock_lock(struct spinlock *lock)
 {
-	while (tas(&lock->lock)) sched_yield();
+	unsigned long fails = 0;
+	unsigned long start = 0;
+
+	// every failed attempt yields
+	while (tas(&lock->lock)) {
+		if (!fails++) start = STAT_CLOCK();
+		sched_yield();
+	}
 
 	lock->pid = getpid();
+
+	spinlock_stat(lock, fails, fails, start);
 }
 
 void spinlock_unlock(struct spinlock *lock)
 {
 	lock->lock = 0;
 }
+
+#endif
@@ -22,14 +22,69 @@
 
 #include <sys/types.h>
 
+#if defined(SPINLOCK_TICKET) || defined(SPINLOCK_MCS)
+#include <stdatomic.h>
+#endif
 
+#include "stats.h"
+
+
+// spins (in units of cpu_relax()) before a waiter yields the cpu
+#ifndef SPINLOCK_SPIN_BUDGET
+#define SPINLOCK_SPIN_BUDGET (1 << 8)
+#endif
+
+// upper bound on the exponential backoff between lock probes
+#ifndef SPINLOCK_BACKOFF_MAX
+#define SPINLOCK_BACKOFF_MAX (1 << 6)
+#endif
+
+// queue nodes per MCS lock, shared by every process that contends on it
+#ifndef SPINLOCK_MCS_SLOTS
+#define SPINLOCK_MCS_SLOTS 128
+#endif
+
+
+#if defined(SPINLOCK_TICKET)
+struct spinlock {
+	atomic_uint next;
+	atomic_uint owner;
+	pid_t       pid;
+#ifdef SYNCMEISTER_STATS
+	struct spinlock_stats stats;
+#endif
+};
+#elif defined(SPINLOCK_MCS)
+// queue links are slot indices offset by one (zero meaning "none")
+// since pointers aren't meaningful across address spaces
+struct mcs_node {
+	_Alignas(64) atomic_uint next;
+	atomic_uint              locked;
+	atomic_uint              busy;
+};
+
+struct spinlock {
+	atomic_uint     tail;
+	unsigned int    slot;
+	pid_t           pid;
+#ifdef SYNCMEISTER_STATS
+	struct spinlock_stats stats;
+#endif
+	struct mcs_node node[SPINLOCK_MCS_SLOTS];
+};
+#else
 struct spinlock {
 	char  lock;
 	pid_t pid;
+#ifdef SYNCMEISTER_STATS
+	struct spinlock_stats stats;
+#endif
 };
+#endif
 
 
 void spinlock_lock(struct spinlock *lock);
+int  spinlock_relax(unsigned long *spins);
 void spinlock_unlock(struct spinlock *lock);
 
 
@@ -0,0 +1,101 @@
+/*
+ * spsc.c -- single-producer/single-consumer FIFO
+ * Copyright (C) 2022  Jacob Koziej <jacobkoziej@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "spsc.h"
+
+#include <stdatomic.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "futex.h"
+
+
+static void spsc_sleep(atomic_uint *flag, atomic_size_t *idx, size_t val)
+{
+	atomic_store_explicit(flag, 1, memory_order_relaxed);
+
+	// pairs with the fence in spsc_wake(): either the other side sees
+	// our flag, or we see its index update here
+	atomic_thread_fence(memory_order_seq_cst);
+
+	if (atomic_load_explicit(idx, memory_order_relaxed) == val)
+		futex_wait(flag, 1);
+
+	atomic_store_explicit(flag, 0, memory_order_relaxed);
+}
+
+static void spsc_wake(atomic_uint *flag)
+{
+	atomic_thread_fence(memory_order_seq_cst);
+
+	// only the first update after the other side went to sleep pays
+	// for the system call
+	if (atomic_load_explicit(flag, memory_order_relaxed)
+		&& atomic_exchange_explicit(flag, 0, memory_order_relaxed))
+		futex_wake(flag, 1);
+}
+
+
+void spsc_init(struct spsc *spsc)
+{
+	memset(spsc, 0, sizeof(*spsc));
+}
+
+unsigned long spsc_rd(struct spsc *spsc)
+{
+	size_t head = atomic_load_explicit(&spsc->head, memory_order_relaxed);
+
+	// only go back to the shared tail once our snapshot runs dry
+	while (head == spsc->tail_cache) {
+		spsc->tail_cache = atomic_load_explicit(
+			&spsc->tail,
+			memory_order_acquire);
+
+		if (head == spsc->tail_cache)
+			spsc_sleep(&spsc->empty, &spsc->tail, head);
+	}
+
+	unsigned long val = spsc->fifo[head % SPSC_BUFSIZ];
+
+	atomic_store_explicit(&spsc->head, head + 1, memory_order_release);
+	spsc_wake(&spsc->full);
+
+	return val;
+}
+
+void spsc_wr(struct spsc *spsc, unsigned long val)
+{
+	size_t tail = atomic_load_explicit(&spsc->tail, memory_order_relaxed);
+
+	while (tail - spsc->head_cache >= SPSC_BUFSIZ) {
+		spsc->head_cache = atomic_load_explicit(
+			&spsc->head,
+			memory_order_acquire);
+
+		if (tail - spsc->head_cache >= SPSC_BUFSIZ)
+			spsc_sleep(
+				&spsc->full,
+				&spsc->head,
+				tail - SPSC_BUFSIZ);
+	}
+
+	spsc->fifo[tail % SPSC_BUFSIZ] = val;
+
+	atomic_store_explicit(&spsc->tail, tail + 1, memory_order_release);
+	spsc_wake(&spsc->empty);
+}
@@ -0,0 +1,50 @@
+/*
+ * spsc.h -- single-producer/single-consumer FIFO
+ * Copyright (C) 2022  Jacob Koziej <jacobkoziej@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef SPSC_H
+#define SPSC_H
+
+
+#include <stdatomic.h>
+#include <stddef.h>
+
+
+#define SPSC_BUFSIZ (1 << 10)
+
+
+// head and tail are free-running and only ever written by the
+// consumer and producer respectively, each on its own cache line
+// alongside that side's cached copy of the other index; full and
+// empty are futex words set by a side before it sleeps
+struct spsc {
+	_Alignas(64) atomic_size_t head;
+	size_t                     tail_cache;
+	_Alignas(64) atomic_size_t tail;
+	size_t                     head_cache;
+	_Alignas(64) atomic_uint   full;
+	atomic_uint                empty;
+	unsigned long              fifo[SPSC_BUFSIZ];
+};
+
+
+void          spsc_init(struct spsc *spsc);
+unsigned long spsc_rd(struct spsc *spsc);
+void          spsc_wr(struct spsc *spsc, unsigned long val);
+
+
+#endif /* SPSC_H */
@@ -0,0 +1,77 @@
+/*
+ * stats.h -- opt-in contention counters
+ * Copyright (C) 2022  Jacob Koziej <jacobkoziej@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef STATS_H
+#define STATS_H
+
+
+#include <stdatomic.h>
+
+
+// counters live in the shared objects themselves so that any process
+// attached to them can read them; without SYNCMEISTER_STATS neither
+// the fields nor the code that updates them exist
+#ifdef SYNCMEISTER_STATS
+
+#define STAT_ADD(stat, n) \
+	atomic_fetch_add_explicit(&(stat), (n), memory_order_relaxed)
+#define STAT_CLOCK() stats_clock()
+
+#else
+
+#define STAT_ADD(stat, n) ((void) (n))
+#define STAT_CLOCK()      0ul
+
+#endif /* SYNCMEISTER_STATS */
+
+#define STAT_INC(stat) STAT_ADD(stat, 1)
+
+
+// contended acquisitions are the ones that failed at least once, with
+// fails counting every failed attempt and wait_ns the time it took
+struct spinlock_stats {
+	atomic_ulong acquired;
+	atomic_ulong contended;
+	atomic_ulong fails;
+	atomic_ulong yields;
+	atomic_ulong wait_ns;
+};
+
+// overflows are waits turned away because the wait queue was full
+struct cv_stats {
+	atomic_ulong waits;
+	atomic_ulong signals;
+	atomic_ulong broadcasts;
+	atomic_ulong overflows;
+	atomic_ulong wait_ns;
+};
+
+// empty and full count the operations that had to block
+struct fifo_stats {
+	atomic_ulong reads;
+	atomic_ulong writes;
+	atomic_ulong empty;
+	atomic_ulong full;
+	atomic_ulong wait_ns;
+};
+
+
+unsigned long stats_clock(void);
+
+
+#endif /* STATS_H */
@@ -20,7 +20,8 @@
 #define TAS_H
 
 
-int tas(volatile char *lock);
+void cpu_relax(void);
+int  tas(volatile char *lock);
 
 
 #endif /* TAS_H */
@@ -11,4 +11,10 @@ tas:
 	pop 		%rbp
 	ret
 
+.global	cpu_relax
+.type	cpu_relax, @function
+cpu_relax:
+	pause
+	ret
+
 .section .note.GNU-stack, "", %progbits
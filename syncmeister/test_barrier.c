@@ -0,0 +1,140 @@
+/*
+ * test_barrier.c -- test primitive process barrier
+ * Copyright (C) 2022  Jacob Koziej <jacobkoziej@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "barrier.h"
+
+
+struct shared {
+	struct barrier barrier;
+	unsigned long  failed;
+	unsigned long  serial;
+	unsigned long  round[];
+};
+
+
+int main(int argc, char **argv)
+{
+	unsigned long children = 0;
+	unsigned long rounds   = 0;
+
+	int opt;
+	while ((opt = getopt(argc, argv, "c:i:")) != -1) {
+		switch (opt) {
+			case 'c':
+				children = strtoul(optarg, NULL, 0);
+				break;
+
+			case 'i':
+				rounds = strtoul(optarg, NULL, 0);
+				break;
+
+			default:
+				return EXIT_FAILURE;
+		}
+	}
+
+	if (!children) {
+		fputs("need at least one child\n", stderr);
+		return EXIT_FAILURE;
+	}
+
+	struct shared *shm = mmap(
+		NULL,
+		sizeof(*shm) + sizeof(*shm->round) * children,
+		PROT_READ | PROT_WRITE,
+		MAP_ANONYMOUS | MAP_SHARED,
+		-1,
+		0);
+
+	if (shm == MAP_FAILED) {
+		perror("failed to `mmap()` shm");
+		return EXIT_FAILURE;
+	}
+
+	barrier_init(&shm->barrier, children);
+
+	struct timespec start;
+	clock_gettime(CLOCK_MONOTONIC, &start);
+
+	for (unsigned long i = 0; i < children; i++) {
+		pid_t pid = fork();
+
+		if (pid < 0) {
+			perror("failed to `fork()` children");
+			return EXIT_FAILURE;
+		}
+
+		if (pid) continue;
+
+		// everyone publishes the round they're in, and once past the
+		// barrier nobody may still be in the previous one; the
+		// second barrier keeps the fastest from racing ahead before
+		// the others have checked
+		for (unsigned long j = 1; j <= rounds; j++) {
+			shm->round[i] = j;
+
+			if (barrier_wait(&shm->barrier)) ++shm->serial;
+
+			for (unsigned long k = 0; k < children; k++)
+				if (shm->round[k] != j) shm->failed = 1;
+
+			barrier_wait(&shm->barrier);
+		}
+
+		return EXIT_SUCCESS;
+	}
+
+	for (unsigned long i = 0; i < children; i++) wait(NULL);
+
+	struct timespec end;
+	clock_gettime(CLOCK_MONOTONIC, &end);
+
+	struct rusage usage;
+	getrusage(RUSAGE_CHILDREN, &usage);
+
+	double elapsed = (end.tv_sec - start.tv_sec)
+		+ (end.tv_nsec - start.tv_nsec) / 1e9;
+
+	printf("elapsed:  %.6f s\n", elapsed);
+	printf("rounds/s: %.0f\n", rounds / elapsed);
+	printf("csw:      %ld voluntary, %ld involuntary\n",
+		usage.ru_nvcsw,
+		usage.ru_nivcsw);
+
+	if (shm->failed) {
+		puts("crossed the barrier early FAILED");
+		return EXIT_FAILURE;
+	}
+
+	if (shm->serial != rounds) {
+		printf("%lu serial callers for %lu rounds FAILED\n", shm->serial, rounds);
+		return EXIT_FAILURE;
+	}
+
+	puts("TEST PASSED");
+
+	return EXIT_SUCCESS;
+}
@@ -16,17 +16,107 @@
  * along with this program.  If not, see <https://www.gnu.org/licenses/>.
  */
 
+#include <signal.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <sys/mman.h>
+#include <sys/wait.h>
+#include <time.h>
 #include <unistd.h>
 
 #include "cv.h"
 #include "spinlock.h"
 
 
-int main(void)
+// park a crowd on the cv, including one that dies while queued, and
+// release them all with a single broadcast
+static int test_broadcast(
+	struct cv       *cv,
+	struct spinlock *mutex,
+	unsigned long    waiters)
 {
+	int *go = mmap(
+		NULL,
+		sizeof(*go),
+		PROT_READ | PROT_WRITE,
+		MAP_ANONYMOUS | MAP_SHARED,
+		-1,
+		0);
+
+	if (go == MAP_FAILED) {
+		perror("failed to `mmap()` go");
+		return EXIT_FAILURE;
+	}
+
+	*go = 0;
+
+	pid_t doomed = 0;
+
+	for (unsigned long i = 0; i <= waiters; i++) {
+		pid_t pid = fork();
+
+		if (pid < 0) {
+			perror("failed to `fork()` waiters");
+			return EXIT_FAILURE;
+		}
+
+		if (pid) {
+			if (i == waiters / 2) doomed = pid;
+			continue;
+		}
+
+		spinlock_lock(mutex);
+		while (!*go) cv_wait(cv, mutex);
+		spinlock_unlock(mutex);
+
+		exit(EXIT_SUCCESS);
+	}
+
+	puts("sleeping for 1s");
+	sleep(1);
+
+	kill(doomed, SIGKILL);
+	waitpid(doomed, NULL, 0);
+
+	struct timespec start;
+	struct timespec end;
+
+	spinlock_lock(mutex);
+	*go = 1;
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	cv_broadcast(cv);
+	clock_gettime(CLOCK_MONOTONIC, &end);
+
+	spinlock_unlock(mutex);
+
+	printf(
+		"broadcast: %.0f ns\n",
+		(end.tv_sec - start.tv_sec) * 1e9 + (end.tv_nsec - start.tv_nsec));
+
+	for (unsigned long i = 0; i < waiters; i++) wait(NULL);
+
+	puts("TEST PASSED");
+
+	return EXIT_SUCCESS;
+}
+
+int main(int argc, char **argv)
+{
+	unsigned long waiters = 0;
+
+	int opt;
+	while ((opt = getopt(argc, argv, "b:")) != -1) {
+		switch (opt) {
+			case 'b':
+				waiters = strtoul(optarg, NULL, 0);
+				break;
+
+			default:
+				return EXIT_FAILURE;
+		}
+	}
+
 	struct spinlock *lock = mmap(
 		NULL,
 		sizeof(*lock),
@@ -68,6 +158,8 @@ int main(void)
 
 	cv_init(cv);
 
+	if (waiters) return test_broadcast(cv, mutex, waiters);
+
 	switch (fork()) {
 		case -1:
 			perror ("failed to `fork()`");
@@ -16,28 +16,174 @@
  * along with this program.  If not, see <https://www.gnu.org/licenses/>.
  */
 
+#include <errno.h>
+#include <poll.h>
+#include <stdatomic.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/eventfd.h>
 #include <sys/mman.h>
 #include <sys/wait.h>
+#include <time.h>
 #include <unistd.h>
 
 #include "fifo.h"
 
 
+// park a crowd of readers on an empty queue, then feed each one value
+static int test_readers(struct fifo *fifo, unsigned long readers)
+{
+	atomic_uint *seen = mmap(
+		NULL,
+		sizeof(*seen) * readers,
+		PROT_READ | PROT_WRITE,
+		MAP_ANONYMOUS | MAP_SHARED,
+		-1,
+		0);
+
+	if (seen == MAP_FAILED) {
+		perror("failed to `mmap()` seen");
+		return EXIT_FAILURE;
+	}
+
+	for (unsigned long i = 0; i < readers; i++) {
+		pid_t pid = fork();
+
+		if (pid < 0) {
+			perror("failed to `fork()` readers");
+			return EXIT_FAILURE;
+		}
+
+		if (pid) continue;
+
+		unsigned long val = fifo_rd(fifo);
+		if (val < readers) atomic_fetch_add(&seen[val], 1);
+
+		exit(EXIT_SUCCESS);
+	}
+
+	puts("sleeping for 1s");
+	sleep(1);
+
+	for (unsigned long i = 0; i < readers; i++) fifo_wr(fifo, i);
+
+	for (unsigned long i = 0; i < readers; i++) wait(NULL);
+
+	for (unsigned long i = 0; i < readers; i++)
+		if (atomic_load(&seen[i]) != 1) {
+			printf("%lu read %u times FAILED\n", i, atomic_load(&seen[i]));
+			return EXIT_FAILURE;
+		}
+
+	puts("TEST PASSED");
+
+	return EXIT_SUCCESS;
+}
+
+// an empty queue has to refuse a try and give up at the deadline
+static int test_timeout(struct fifo *fifo)
+{
+	unsigned long val;
+
+	if (fifo_try_rd(fifo, &val) >= 0 || errno != EAGAIN) {
+		puts("fifo_try_rd() on empty FAILED");
+		return -1;
+	}
+
+	struct timespec start;
+	struct timespec deadline;
+	struct timespec end;
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+
+	deadline = start;
+	deadline.tv_nsec += 50000000;
+	if (deadline.tv_nsec >= 1000000000) {
+		++deadline.tv_sec;
+		deadline.tv_nsec -= 1000000000;
+	}
+
+	if (fifo_rd_timeout(fifo, &val, &deadline) >= 0 || errno != ETIMEDOUT) {
+		puts("fifo_rd_timeout() on empty FAILED");
+		return -1;
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &end);
+
+	if (end.tv_sec < deadline.tv_sec
+		|| (end.tv_sec == deadline.tv_sec && end.tv_nsec < deadline.tv_nsec)) {
+		puts("fifo_rd_timeout() returned early FAILED");
+		return -1;
+	}
+
+	return 0;
+}
+
+// read the way an event loop would: only wait on the eventfd once the
+// queue has been drained, since it fires on the transition alone
+static size_t rd_event(struct fifo *fifo, int efd, unsigned long *val, size_t n)
+{
+	size_t cnt = 0;
+
+	for (;;) {
+		while (cnt < n && !fifo_try_rd(fifo, &val[cnt])) ++cnt;
+		if (cnt) return cnt;
+
+		struct pollfd pfd = {
+			.fd     = efd,
+			.events = POLLIN,
+		};
+
+		poll(&pfd, 1, -1);
+
+		uint64_t events;
+		if (read(efd, &events, sizeof(events)) != sizeof(events)) {
+			perror("failed to `read()` eventfd");
+			exit(EXIT_FAILURE);
+		}
+	}
+}
+
 int main(int argc, char **argv)
 {
+	unsigned long batch    = 1;
 	unsigned long children = 0;
+	int           events   = 0;
+	unsigned long readers  = 0;
 	unsigned long writes   = 0;
+	unsigned long size     = FIFO_BUFSIZ;
+	const char   *name     = NULL;
 
 	int opt;
-	while ((opt = getopt(argc, argv, "c:w:")) != -1) {
+	while ((opt = getopt(argc, argv, "b:c:en:r:s:w:")) != -1) {
 		switch (opt) {
+			case 'b':
+				batch = strtoul(optarg, NULL, 0);
+				if (!batch) batch = 1;
+				break;
+
 			case 'c':
 				children = strtoul(optarg, NULL, 0);
 				break;
 
+			case 'e':
+				events = 1;
+				break;
+
+			case 'n':
+				name = optarg;
+				break;
+
+			case 'r':
+				readers = strtoul(optarg, NULL, 0);
+				break;
+
+			case 's':
+				size = strtoul(optarg, NULL, 0);
+				break;
+
 			case 'w':
 				writes = strtoul(optarg, NULL, 0);
 				break;
@@ -47,20 +193,36 @@ int main(int argc, char **argv)
 		}
 	}
 
-	struct fifo *fifo = mmap(
-		NULL,
-		sizeof(*fifo),
-		PROT_READ | PROT_WRITE,
-		MAP_ANONYMOUS | MAP_SHARED,
-		-1,
-		0);
+	struct fifo *fifo = fifo_create(name, size);
 
-	if (fifo == MAP_FAILED) {
-		perror("failed to `mmap()` spinlock");
+	if (!fifo) {
+		perror("failed to `fifo_create()` fifo");
 		return EXIT_FAILURE;
 	}
 
-	fifo_init(fifo);
+	if (readers) {
+		int ret = test_readers(fifo, readers);
+
+		if (name) fifo_unlink(name);
+
+		return ret;
+	}
+
+	int efd = -1;
+
+	if (events) {
+		if (test_timeout(fifo) < 0) return EXIT_FAILURE;
+
+		// a drained queue with a leftover count just costs a
+		// spurious wakeup, which the reader has to handle anyway
+		efd = eventfd(0, EFD_NONBLOCK);
+		if (efd < 0) {
+			perror("failed to `eventfd()`");
+			return EXIT_FAILURE;
+		}
+
+		fifo_set_eventfd(fifo, efd);
+	}
 
 	pid_t pid[children];
 	memset(pid, 0, sizeof(pid));
@@ -80,15 +242,38 @@ int main(int argc, char **argv)
 		++i;
 	}
 
-	if (!pid[i]) {
+	if (i < children) {
 		pid[i] = getpid();
 
+		// attach by name the way an unrelated process would
+		if (name) {
+			fifo_destroy(fifo);
+
+			fifo = fifo_attach(name);
+			if (!fifo) {
+				perror("failed to `fifo_attach()` fifo");
+				return EXIT_FAILURE;
+			}
+		}
+
+		unsigned long buf[batch];
 		unsigned long counter = 0;
-		while (writes--) {
-			unsigned long val =
-				((unsigned long) pid[i] << 32) | counter++;
 
-			fifo_wr(fifo, val);
+		while (counter < writes) {
+			size_t cnt = 0;
+
+			while (cnt < batch && counter < writes)
+				buf[cnt++] =
+					((unsigned long) pid[i] << 32) | counter++;
+
+			if (batch == 1) {
+				fifo_wr(fifo, buf[0]);
+				continue;
+			}
+
+			// a partial batch leaves the rest for the next call
+			for (size_t off = 0; off < cnt;)
+				off += fifo_wr_n(fifo, buf + off, cnt - off);
 		}
 
 		return EXIT_SUCCESS;
@@ -97,29 +282,48 @@ int main(int argc, char **argv)
 	unsigned long expected[children];
 	memset(expected, 0, sizeof(expected));
 
+	unsigned long buf[batch];
 	unsigned long read_cnt = children * writes;
-	for (i = 0; i < read_cnt; i++) {
-		unsigned long raw = fifo_rd(fifo);
 
-		unsigned long val = raw & 0xffff;
-		pid_t cpid = raw >> 32;
+	while (read_cnt) {
+		size_t cnt = 1;
 
-		printf("pid: %u, val: %lu\n", cpid, val);
+		if (events) cnt = rd_event(
+			fifo,
+			efd,
+			buf,
+			(batch < read_cnt) ? batch : read_cnt);
+		else if (batch == 1) buf[0] = fifo_rd(fifo);
+		else cnt = fifo_rd_n(
+			fifo,
+			buf,
+			(batch < read_cnt) ? batch : read_cnt);
 
-		for (unsigned long j = 0; j < children; j++)
-			if (pid[j] == cpid) {
-				if (val != expected[j]++) {
-					printf("%u FAILED\n", cpid);
-					return EXIT_FAILURE;
-				}
+		read_cnt -= cnt;
 
-				break;
-			}
+		for (size_t k = 0; k < cnt; k++) {
+			unsigned long val = buf[k] & 0xffffffff;
+			pid_t cpid = buf[k] >> 32;
+
+			printf("pid: %u, val: %lu\n", cpid, val);
+
+			for (unsigned long j = 0; j < children; j++)
+				if (pid[j] == cpid) {
+					if (val != expected[j]++) {
+						printf("%u FAILED\n", cpid);
+						return EXIT_FAILURE;
+					}
+
+					break;
+				}
+		}
 	}
 
 	for (i = 0; i < children; i++)
 		wait(NULL);
 
+	if (name) fifo_unlink(name);
+
 	puts("TEST PASSED");
 
 	return EXIT_SUCCESS;
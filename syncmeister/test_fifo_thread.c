@@ -0,0 +1,120 @@
+/*
+ * test_fifo_thread.c -- test primitive FIFO between threads
+ * Copyright (C) 2022  Jacob Koziej <jacobkoziej@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "fifo.h"
+
+
+struct writer {
+	pthread_t      thread;
+	struct fifo   *fifo;
+	unsigned long  id;
+	unsigned long  writes;
+};
+
+
+static void *writer(void *arg)
+{
+	struct writer *w = arg;
+
+	for (unsigned long counter = 0; counter < w->writes; counter++)
+		fifo_wr(w->fifo, (w->id << 32) | counter);
+
+	return NULL;
+}
+
+int main(int argc, char **argv)
+{
+	unsigned long children = 0;
+	unsigned long writes   = 0;
+	unsigned long size     = FIFO_BUFSIZ;
+
+	int opt;
+	while ((opt = getopt(argc, argv, "c:s:w:")) != -1) {
+		switch (opt) {
+			case 'c':
+				children = strtoul(optarg, NULL, 0);
+				break;
+
+			case 's':
+				size = strtoul(optarg, NULL, 0);
+				break;
+
+			case 'w':
+				writes = strtoul(optarg, NULL, 0);
+				break;
+
+			default:
+				return EXIT_FAILURE;
+		}
+	}
+
+	if (!size) size = 1;
+
+	// threads share our address space, so plain heap memory will do
+	struct fifo *fifo = malloc(FIFO_SIZEOF(size));
+
+	if (!fifo) {
+		perror("failed to `malloc()` fifo");
+		return EXIT_FAILURE;
+	}
+
+	fifo_init(fifo, size);
+
+	struct writer w[children];
+
+	for (unsigned long i = 0; i < children; i++) {
+		w[i].fifo   = fifo;
+		w[i].id     = i;
+		w[i].writes = writes;
+
+		int err = pthread_create(&w[i].thread, NULL, writer, &w[i]);
+		if (err) {
+			fprintf(stderr, "failed to `pthread_create()`: %s\n", strerror(err));
+			return EXIT_FAILURE;
+		}
+	}
+
+	unsigned long expected[children];
+	memset(expected, 0, sizeof(expected));
+
+	for (unsigned long read_cnt = children * writes; read_cnt; read_cnt--) {
+		unsigned long raw = fifo_rd(fifo);
+		unsigned long id  = raw >> 32;
+		unsigned long val = raw & 0xffffffff;
+
+		if (id >= children || val != expected[id]++) {
+			printf("thread: %lu, val: %lu FAILED\n", id, val);
+			return EXIT_FAILURE;
+		}
+	}
+
+	for (unsigned long i = 0; i < children; i++)
+		pthread_join(w[i].thread, NULL);
+
+	free(fifo);
+
+	puts("TEST PASSED");
+
+	return EXIT_SUCCESS;
+}
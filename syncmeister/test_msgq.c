@@ -0,0 +1,228 @@
+/*
+ * test_msgq.c -- test primitive message queue
+ * Copyright (C) 2022  Jacob Koziej <jacobkoziej@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <sched.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "msgq.h"
+
+
+// every message starts with who sent it and its sequence number,
+// followed by filler derived from both so corruption is caught
+struct msg {
+	uint32_t child;
+	uint32_t counter;
+};
+
+
+static unsigned char filler(const struct msg *msg, size_t i)
+{
+	return msg->child * 31 + msg->counter + i;
+}
+
+static int check(
+	const unsigned char *buf,
+	ssize_t              len,
+	unsigned long       *expected,
+	unsigned long        children)
+{
+	if (len < (ssize_t) sizeof(struct msg)) {
+		printf("short message of %zd bytes FAILED\n", len);
+		return -1;
+	}
+
+	struct msg msg;
+	memcpy(&msg, buf, sizeof(msg));
+
+	if (msg.child >= children
+		|| msg.counter != expected[msg.child]++) {
+		printf(
+			"child: %u, counter: %u FAILED\n",
+			msg.child,
+			msg.counter
+		);
+		return -1;
+	}
+
+	for (ssize_t k = sizeof(msg); k < len; k++)
+		if (buf[k] != filler(&msg, k)) {
+			printf(
+				"child: %u, counter: %u corrupt FAILED\n",
+				msg.child,
+				msg.counter
+			);
+			return -1;
+		}
+
+	return 0;
+}
+
+int main(int argc, char **argv)
+{
+	unsigned long children = 0;
+	unsigned long writes   = 0;
+	unsigned long maxlen   = 256;
+	int           inplace  = 0;
+
+	int opt;
+	while ((opt = getopt(argc, argv, "c:m:w:z")) != -1) {
+		switch (opt) {
+			case 'c':
+				children = strtoul(optarg, NULL, 0);
+				break;
+
+			case 'm':
+				maxlen = strtoul(optarg, NULL, 0);
+				break;
+
+			case 'w':
+				writes = strtoul(optarg, NULL, 0);
+				break;
+
+			case 'z':
+				inplace = 1;
+				break;
+
+			default:
+				return EXIT_FAILURE;
+		}
+	}
+
+	if (maxlen < sizeof(struct msg)) maxlen = sizeof(struct msg);
+	if (maxlen > MSGQ_MSGMAX) maxlen = MSGQ_MSGMAX;
+
+	// the reader sits on two records at a time when zero-copy, which
+	// must always leave a writer room to make progress
+	if (inplace && maxlen > MSGQ_BUFSIZ / 4) maxlen = MSGQ_BUFSIZ / 4;
+
+	struct msgq *msgq = mmap(
+		NULL,
+		sizeof(*msgq),
+		PROT_READ | PROT_WRITE,
+		MAP_ANONYMOUS | MAP_SHARED,
+		-1,
+		0);
+
+	if (msgq == MAP_FAILED) {
+		perror("failed to `mmap()` msgq");
+		return EXIT_FAILURE;
+	}
+
+	msgq_init(msgq);
+
+	unsigned char *buf = malloc(maxlen);
+	if (!buf) {
+		perror("failed to `malloc()` buffer");
+		return EXIT_FAILURE;
+	}
+
+	for (unsigned long i = 0; i < children; i++) {
+		pid_t pid = fork();
+
+		if (pid < 0) {
+			perror("failed to `fork()` children");
+			return EXIT_FAILURE;
+		}
+
+		if (pid) continue;
+
+		unsigned int seed = i;
+
+		for (unsigned long j = 0; j < writes; j++) {
+			struct msg msg = {
+				.child   = i,
+				.counter = j,
+			};
+
+			size_t len = sizeof(msg)
+				+ rand_r(&seed) % (maxlen - sizeof(msg) + 1);
+
+			unsigned char *out = buf;
+
+			if (inplace) {
+				out = msgq_reserve(msgq, len);
+
+				// give other writers a chance to reserve
+				// and commit ahead of us
+				if (j % 3) sched_yield();
+			}
+
+			memcpy(out, &msg, sizeof(msg));
+			for (size_t k = sizeof(msg); k < len; k++)
+				out[k] = filler(&msg, k);
+
+			if (inplace) {
+				msgq_commit(msgq, out);
+				continue;
+			}
+
+			if (msgq_send(msgq, out, len) < 0) {
+				perror("failed to `msgq_send()`");
+				return EXIT_FAILURE;
+			}
+		}
+
+		return EXIT_SUCCESS;
+	}
+
+	unsigned long expected[children];
+	memset(expected, 0, sizeof(expected));
+
+	unsigned long read_cnt = children * writes;
+
+	while (read_cnt) {
+		if (!inplace) {
+			ssize_t len = msgq_recv(msgq, buf, maxlen);
+
+			if (check(buf, len, expected, children) < 0)
+				return EXIT_FAILURE;
+
+			--read_cnt;
+			continue;
+		}
+
+		// hold two records at once and release them out of order
+		size_t         len[2];
+		unsigned char *msg[2];
+		size_t         cnt = (read_cnt < 2) ? read_cnt : 2;
+
+		for (size_t k = 0; k < cnt; k++) {
+			msg[k] = msgq_peek(msgq, &len[k]);
+
+			if (check(msg[k], len[k], expected, children) < 0)
+				return EXIT_FAILURE;
+		}
+
+		while (cnt--) {
+			msgq_release(msgq, msg[cnt]);
+			--read_cnt;
+		}
+	}
+
+	for (unsigned long i = 0; i < children; i++) wait(NULL);
+
+	puts("TEST PASSED");
+
+	return EXIT_SUCCESS;
+}
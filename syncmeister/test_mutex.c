@@ -0,0 +1,168 @@
+/*
+ * test_mutex.c -- test primitive adaptive mutex
+ * Copyright (C) 2022  Jacob Koziej <jacobkoziej@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "mutex.h"
+#include "spinlock.h"
+#include "tas.h"
+
+
+struct shm {
+	struct mutex    mutex;
+	struct spinlock spinlock;
+	unsigned long   counter;
+};
+
+
+static double elapsed(const struct timespec *start, const struct timespec *end)
+{
+	return (end->tv_sec - start->tv_sec)
+		+ (end->tv_nsec - start->tv_nsec) / 1e9;
+}
+
+int main(int argc, char **argv)
+{
+	unsigned long children   = 0;
+	unsigned long increments = 0;
+	unsigned long hold       = 0;
+	unsigned long sleep_ns   = 0;
+	int           spin       = 0;
+
+	int opt;
+	while ((opt = getopt(argc, argv, "c:h:i:m:s:")) != -1) {
+		switch (opt) {
+			case 'c':
+				children = strtoul(optarg, NULL, 0);
+				break;
+
+			case 'h':
+				hold = strtoul(optarg, NULL, 0);
+				break;
+
+			case 'i':
+				increments = strtoul(optarg, NULL, 0);
+				break;
+
+			case 'm':
+				if (!strcmp(optarg, "mutex")) spin = 0;
+				else if (!strcmp(optarg, "spinlock")) spin = 1;
+				else {
+					fprintf(stderr, "unknown lock `%s`\n", optarg);
+					return EXIT_FAILURE;
+				}
+				break;
+
+			case 's':
+				sleep_ns = strtoul(optarg, NULL, 0);
+				break;
+
+			default:
+				return EXIT_FAILURE;
+		}
+	}
+
+	struct shm *shm = mmap(
+		NULL,
+		sizeof(*shm),
+		PROT_READ | PROT_WRITE,
+		MAP_ANONYMOUS | MAP_SHARED,
+		-1,
+		0);
+
+	if (shm == MAP_FAILED) {
+		perror("failed to `mmap()` shm");
+		return EXIT_FAILURE;
+	}
+
+	memset(shm, 0, sizeof(*shm));
+	mutex_init(&shm->mutex);
+
+	struct timespec start;
+	clock_gettime(CLOCK_MONOTONIC, &start);
+
+	for (unsigned long i = 0; i < children; i++) {
+		pid_t pid = fork();
+
+		if (pid < 0) {
+			perror("failed to `fork()` children");
+			return EXIT_FAILURE;
+		}
+
+		if (pid) continue;
+
+		// -h busy-waits and -s sleeps inside the critical section,
+		// covering both ends of the hold times a mutex has to handle
+		struct timespec nap = {
+			.tv_sec  = sleep_ns / 1000000000,
+			.tv_nsec = sleep_ns % 1000000000,
+		};
+
+		for (unsigned long j = 0; j < increments; j++) {
+			if (spin) spinlock_lock(&shm->spinlock);
+			else mutex_lock(&shm->mutex);
+
+			++shm->counter;
+
+			for (unsigned long k = 0; k < hold; k++) cpu_relax();
+			if (sleep_ns) nanosleep(&nap, NULL);
+
+			if (spin) spinlock_unlock(&shm->spinlock);
+			else mutex_unlock(&shm->mutex);
+		}
+
+		return EXIT_SUCCESS;
+	}
+
+	for (unsigned long i = 0; i < children; i++) wait(NULL);
+
+	struct timespec end;
+	clock_gettime(CLOCK_MONOTONIC, &end);
+
+	struct rusage usage;
+	getrusage(RUSAGE_CHILDREN, &usage);
+
+	double total = elapsed(&start, &end);
+
+	printf("expected: %lu\n", increments * children);
+	printf("got:      %lu\n", shm->counter);
+	printf("elapsed:  %.6f s\n", total);
+	printf("ops/s:    %.0f\n", increments * children / total);
+	printf("cpu:      %.6f s\n",
+		usage.ru_utime.tv_sec + usage.ru_utime.tv_usec / 1e6
+		+ usage.ru_stime.tv_sec + usage.ru_stime.tv_usec / 1e6);
+	printf("csw:      %ld voluntary, %ld involuntary\n",
+		usage.ru_nvcsw,
+		usage.ru_nivcsw);
+
+	if (shm->counter != increments * children) {
+		puts("counter FAILED");
+		return EXIT_FAILURE;
+	}
+
+	puts("TEST PASSED");
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,225 @@
+/*
+ * test_rwlock.c -- benchmark reader-writer locks
+ * Copyright (C) 2022  Jacob Koziej <jacobkoziej@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "rwlock.h"
+#include "seqlock.h"
+#include "spinlock.h"
+
+
+enum {
+	MODE_RWLOCK,
+	MODE_SEQLOCK,
+	MODE_SPINLOCK,
+};
+
+
+// a writer always leaves both halves equal, so a reader that sees them
+// differ has caught a writer mid-update
+struct data {
+	unsigned long a;
+	unsigned long b;
+};
+
+struct shm {
+	struct rwlock   rwlock;
+	struct seqlock  seqlock;
+	struct spinlock spinlock;
+	struct data     data;
+};
+
+
+static double elapsed(const struct timespec *start, const struct timespec *end)
+{
+	return (end->tv_sec - start->tv_sec)
+		+ (end->tv_nsec - start->tv_nsec) / 1e9;
+}
+
+static int rd(struct shm *shm, int mode)
+{
+	struct data data;
+
+	switch (mode) {
+		case MODE_RWLOCK:
+			rwlock_rdlock(&shm->rwlock);
+			data = shm->data;
+			rwlock_rdunlock(&shm->rwlock);
+			break;
+
+		case MODE_SEQLOCK:
+			seqlock_read(&shm->seqlock, &data, &shm->data, sizeof(data));
+			break;
+
+		default:
+			spinlock_lock(&shm->spinlock);
+			data = shm->data;
+			spinlock_unlock(&shm->spinlock);
+			break;
+	}
+
+	return (data.a == data.b) ? 0 : -1;
+}
+
+static void wr(struct shm *shm, int mode)
+{
+	switch (mode) {
+		case MODE_RWLOCK:
+			rwlock_wrlock(&shm->rwlock);
+			++shm->data.a;
+			++shm->data.b;
+			rwlock_wrunlock(&shm->rwlock);
+			break;
+
+		case MODE_SEQLOCK:
+			seqlock_write_lock(&shm->seqlock);
+			++shm->data.a;
+			++shm->data.b;
+			seqlock_write_unlock(&shm->seqlock);
+			break;
+
+		default:
+			spinlock_lock(&shm->spinlock);
+			++shm->data.a;
+			++shm->data.b;
+			spinlock_unlock(&shm->spinlock);
+			break;
+	}
+}
+
+int main(int argc, char **argv)
+{
+	unsigned long children = 0;
+	unsigned long ops      = 0;
+	unsigned long reads    = 95;
+	int           mode     = MODE_RWLOCK;
+
+	int opt;
+	while ((opt = getopt(argc, argv, "c:i:m:r:")) != -1) {
+		switch (opt) {
+			case 'c':
+				children = strtoul(optarg, NULL, 0);
+				break;
+
+			case 'i':
+				ops = strtoul(optarg, NULL, 0);
+				break;
+
+			case 'm':
+				if (!strcmp(optarg, "rwlock")) mode = MODE_RWLOCK;
+				else if (!strcmp(optarg, "seqlock")) mode = MODE_SEQLOCK;
+				else if (!strcmp(optarg, "spinlock")) mode = MODE_SPINLOCK;
+				else {
+					fprintf(stderr, "unknown lock `%s`\n", optarg);
+					return EXIT_FAILURE;
+				}
+				break;
+
+			case 'r':
+				reads = strtoul(optarg, NULL, 0);
+				if (reads > 100) reads = 100;
+				break;
+
+			default:
+				return EXIT_FAILURE;
+		}
+	}
+
+	struct shm *shm = mmap(
+		NULL,
+		sizeof(*shm),
+		PROT_READ | PROT_WRITE,
+		MAP_ANONYMOUS | MAP_SHARED,
+		-1,
+		0);
+
+	if (shm == MAP_FAILED) {
+		perror("failed to `mmap()` shm");
+		return EXIT_FAILURE;
+	}
+
+	memset(shm, 0, sizeof(*shm));
+
+	struct timespec start;
+	clock_gettime(CLOCK_MONOTONIC, &start);
+
+	for (unsigned long i = 0; i < children; i++) {
+		pid_t pid = fork();
+
+		if (pid < 0) {
+			perror("failed to `fork()` children");
+			return EXIT_FAILURE;
+		}
+
+		if (pid) continue;
+
+		// spread the writes evenly through the run rather than
+		// drawing them at random, so every lock sees the same mix
+		for (unsigned long j = 0; j < ops; j++) {
+			if ((j % 100) >= reads) {
+				wr(shm, mode);
+				continue;
+			}
+
+			if (rd(shm, mode) < 0) {
+				printf("child %lu saw a torn read FAILED\n", i);
+				return EXIT_FAILURE;
+			}
+		}
+
+		return EXIT_SUCCESS;
+	}
+
+	int failed = 0;
+	int status;
+
+	for (unsigned long i = 0; i < children; i++) {
+		wait(&status);
+		if (!WIFEXITED(status) || WEXITSTATUS(status)) failed = 1;
+	}
+
+	struct timespec end;
+	clock_gettime(CLOCK_MONOTONIC, &end);
+
+	unsigned long expected = 0;
+	for (unsigned long j = 0; j < ops; j++)
+		if ((j % 100) >= reads) ++expected;
+	expected *= children;
+
+	double total = elapsed(&start, &end);
+
+	printf("expected: %lu\n", expected);
+	printf("got:      %lu\n", shm->data.a);
+	printf("elapsed:  %.6f s\n", total);
+	printf("ops/s:    %.0f\n", ops * children / total);
+
+	if (failed || shm->data.a != expected || shm->data.b != expected) {
+		puts("lost updates or torn reads FAILED");
+		return EXIT_FAILURE;
+	}
+
+	puts("TEST PASSED");
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,148 @@
+/*
+ * test_sema.c -- test primitive counting semaphore
+ * Copyright (C) 2022  Jacob Koziej <jacobkoziej@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "sema.h"
+
+
+struct shared {
+	struct sema  sema;
+	atomic_ulong inside;
+	atomic_ulong peak;
+	atomic_ulong total;
+};
+
+
+int main(int argc, char **argv)
+{
+	unsigned long children   = 0;
+	unsigned long iterations = 0;
+	unsigned long permits    = 1;
+
+	int opt;
+	while ((opt = getopt(argc, argv, "c:i:n:")) != -1) {
+		switch (opt) {
+			case 'c':
+				children = strtoul(optarg, NULL, 0);
+				break;
+
+			case 'i':
+				iterations = strtoul(optarg, NULL, 0);
+				break;
+
+			case 'n':
+				permits = strtoul(optarg, NULL, 0);
+				break;
+
+			default:
+				return EXIT_FAILURE;
+		}
+	}
+
+	struct shared *shm = mmap(
+		NULL,
+		sizeof(*shm),
+		PROT_READ | PROT_WRITE,
+		MAP_ANONYMOUS | MAP_SHARED,
+		-1,
+		0);
+
+	if (shm == MAP_FAILED) {
+		perror("failed to `mmap()` shm");
+		return EXIT_FAILURE;
+	}
+
+	sema_init(&shm->sema, permits);
+
+	struct timespec start;
+	clock_gettime(CLOCK_MONOTONIC, &start);
+
+	for (unsigned long i = 0; i < children; i++) {
+		pid_t pid = fork();
+
+		if (pid < 0) {
+			perror("failed to `fork()` children");
+			return EXIT_FAILURE;
+		}
+
+		if (pid) continue;
+
+		for (unsigned long j = 0; j < iterations; j++) {
+			sema_wait(&shm->sema);
+
+			unsigned long inside = atomic_fetch_add(&shm->inside, 1) + 1;
+
+			unsigned long peak = atomic_load(&shm->peak);
+			while (inside > peak
+				&& !atomic_compare_exchange_weak(&shm->peak, &peak, inside));
+
+			atomic_fetch_add(&shm->total, 1);
+
+			// hold the permit long enough for others to pile up
+			if (!(j % 64)) sched_yield();
+
+			atomic_fetch_sub(&shm->inside, 1);
+
+			sema_post(&shm->sema);
+		}
+
+		return EXIT_SUCCESS;
+	}
+
+	for (unsigned long i = 0; i < children; i++) wait(NULL);
+
+	struct timespec end;
+	clock_gettime(CLOCK_MONOTONIC, &end);
+
+	struct rusage usage;
+	getrusage(RUSAGE_CHILDREN, &usage);
+
+	double elapsed = (end.tv_sec - start.tv_sec)
+		+ (end.tv_nsec - start.tv_nsec) / 1e9;
+
+	printf("permits:  %lu\n", permits);
+	printf("peak:     %lu\n", atomic_load(&shm->peak));
+	printf("elapsed:  %.6f s\n", elapsed);
+	printf("ops/s:    %.0f\n", children * iterations / elapsed);
+	printf("csw:      %ld voluntary, %ld involuntary\n",
+		usage.ru_nvcsw,
+		usage.ru_nivcsw);
+
+	if (atomic_load(&shm->peak) > permits) {
+		puts("too many holders FAILED");
+		return EXIT_FAILURE;
+	}
+
+	if (atomic_load(&shm->total) != children * iterations) {
+		puts("short FAILED");
+		return EXIT_FAILURE;
+	}
+
+	puts("TEST PASSED");
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,202 @@
+/*
+ * test_shard.c -- benchmark sharded FIFO
+ * Copyright (C) 2022  Jacob Koziej <jacobkoziej@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "fifo.h"
+#include "shard.h"
+
+
+struct shared {
+	atomic_ulong failed;
+	atomic_ulong got[];
+};
+
+
+static struct fifo   *fifo;
+static struct shard  *shard;
+static struct shared *shm;
+static int            keyed;
+static int            use_fifo;
+
+
+static unsigned long rd(size_t self)
+{
+	return (use_fifo) ? fifo_rd(fifo) : shard_rd(shard, self);
+}
+
+static void wr(unsigned long key, unsigned long val)
+{
+	if (use_fifo) fifo_wr(fifo, val);
+	else if (keyed) shard_wr_key(shard, key, val);
+	else shard_wr(shard, val);
+}
+
+int main(int argc, char **argv)
+{
+	unsigned long producers = 1;
+	unsigned long consumers = 1;
+	unsigned long writes    = 0;
+
+	int opt;
+	while ((opt = getopt(argc, argv, "c:fkp:w:")) != -1) {
+		switch (opt) {
+			case 'c':
+				consumers = strtoul(optarg, NULL, 0);
+				break;
+
+			case 'f':
+				use_fifo = 1;
+				break;
+
+			case 'k':
+				keyed = 1;
+				break;
+
+			case 'p':
+				producers = strtoul(optarg, NULL, 0);
+				break;
+
+			case 'w':
+				writes = strtoul(optarg, NULL, 0);
+				break;
+
+			default:
+				return EXIT_FAILURE;
+		}
+	}
+
+	if (!producers || !consumers) {
+		fputs("need at least one producer and consumer\n", stderr);
+		return EXIT_FAILURE;
+	}
+
+	shm = mmap(
+		NULL,
+		sizeof(*shm) + sizeof(*shm->got) * producers,
+		PROT_READ | PROT_WRITE,
+		MAP_ANONYMOUS | MAP_SHARED,
+		-1,
+		0);
+
+	if (shm == MAP_FAILED) {
+		perror("failed to `mmap()` counters");
+		return EXIT_FAILURE;
+	}
+
+	// the same total capacity either way, so neither side gets to
+	// absorb more of a burst than the other
+	fifo  = fifo_create(NULL, FIFO_BUFSIZ);
+	shard = shard_create(consumers, (FIFO_BUFSIZ + consumers - 1) / consumers);
+
+	if (!fifo || !shard) {
+		perror("failed to create queues");
+		return EXIT_FAILURE;
+	}
+
+	struct timespec start;
+	clock_gettime(CLOCK_MONOTONIC, &start);
+
+	for (unsigned long i = 0; i < producers; i++) {
+		pid_t pid = fork();
+
+		if (pid < 0) {
+			perror("failed to `fork()` producers");
+			return EXIT_FAILURE;
+		}
+
+		if (pid) continue;
+
+		for (unsigned long j = 0; j < writes; j++)
+			wr(i, (i << 32) | j);
+
+		return EXIT_SUCCESS;
+	}
+
+	unsigned long total = producers * writes;
+
+	for (unsigned long i = 0; i < consumers; i++) {
+		pid_t pid = fork();
+
+		if (pid < 0) {
+			perror("failed to `fork()` consumers");
+			return EXIT_FAILURE;
+		}
+
+		if (pid) continue;
+
+		unsigned long reads = total / consumers
+			+ (i < total % consumers);
+
+		// only a single queue or a keyed shard keeps a producer's
+		// values in order, and then every consumer sees a
+		// subsequence of that order
+		int  ordered = use_fifo || keyed;
+		long last[producers];
+		for (unsigned long j = 0; j < producers; j++) last[j] = -1;
+
+		while (reads--) {
+			unsigned long raw  = rd(i);
+			unsigned long prod = raw >> 32;
+			long          val  = raw & 0xffffffff;
+
+			if (prod >= producers || (ordered && val <= last[prod])) {
+				atomic_fetch_add(&shm->failed, 1);
+				continue;
+			}
+
+			last[prod] = val;
+			atomic_fetch_add(&shm->got[prod], 1);
+		}
+
+		return EXIT_SUCCESS;
+	}
+
+	for (unsigned long i = 0; i < producers + consumers; i++) wait(NULL);
+
+	struct timespec end;
+	clock_gettime(CLOCK_MONOTONIC, &end);
+
+	double elapsed = (end.tv_sec - start.tv_sec)
+		+ (end.tv_nsec - start.tv_nsec) / 1e9;
+
+	printf("queue:    %s\n", (use_fifo) ? "fifo" : "shard");
+	printf("elapsed:  %.6f s\n", elapsed);
+	printf("ops/s:    %.0f\n", total / elapsed);
+
+	if (atomic_load(&shm->failed)) {
+		printf("%lu out of order FAILED\n", atomic_load(&shm->failed));
+		return EXIT_FAILURE;
+	}
+
+	for (unsigned long i = 0; i < producers; i++)
+		if (atomic_load(&shm->got[i]) != writes) {
+			printf("producer %lu short FAILED\n", i);
+			return EXIT_FAILURE;
+		}
+
+	puts("TEST PASSED");
+
+	return EXIT_SUCCESS;
+}
@@ -21,11 +21,18 @@
 #include <stdlib.h>
 #include <sys/mman.h>
 #include <sys/wait.h>
+#include <time.h>
 #include <unistd.h>
 
 #include "spinlock.h"
 
 
+static double elapsed(const struct timespec *start, const struct timespec *end)
+{
+	return (end->tv_sec - start->tv_sec)
+		+ (end->tv_nsec - start->tv_nsec) / 1e9;
+}
+
 int main(int argc, char **argv)
 {
 	unsigned long children   = 0;
@@ -73,8 +80,26 @@ int main(int argc, char **argv)
 		return EXIT_FAILURE;
 	}
 
+	// per-child completion times, used to gauge fairness
+	struct timespec *done = mmap(
+		NULL,
+		sizeof(*done) * (children ? children : 1),
+		PROT_READ | PROT_WRITE,
+		MAP_ANONYMOUS | MAP_SHARED,
+		-1,
+		0);
+
+	if (done == MAP_FAILED) {
+		perror("failed to `mmap()` completion times");
+		return EXIT_FAILURE;
+	}
+
+	struct timespec start;
+	clock_gettime(CLOCK_MONOTONIC, &start);
+
 	pid_t pid;
-	for (unsigned long i = 0; i < children; i++) {
+	unsigned long i;
+	for (i = 0; i < children; i++) {
 		pid = fork();
 
 		if (pid < 0) {
@@ -92,13 +117,34 @@ int main(int argc, char **argv)
 			spinlock_unlock(lock);
 		}
 
+		clock_gettime(CLOCK_MONOTONIC, &done[i]);
+
 		return EXIT_SUCCESS;
 	}
 
-	for (unsigned long i = 0; i < children; i++) wait(NULL);
+	for (i = 0; i < children; i++) wait(NULL);
+
+	struct timespec end;
+	clock_gettime(CLOCK_MONOTONIC, &end);
+
+	// Jain's fairness index over per-child throughput: 1.0 when
+	// every child progressed at the same rate, 1/n when one hogged
+	double sum   = 0;
+	double sumsq = 0;
+	for (i = 0; i < children; i++) {
+		double rate = increments / elapsed(&start, &done[i]);
+
+		sum   += rate;
+		sumsq += rate * rate;
+	}
+
+	double total = elapsed(&start, &end);
 
 	printf("expected: %lu\n", increments * children);
 	printf("got:      %lu\n", *counter);
+	printf("elapsed:  %.6f s\n", total);
+	printf("ops/s:    %.0f\n", increments * children / total);
+	printf("fairness: %.4f\n", (sumsq) ? sum * sum / (children * sumsq) : 0);
 
 	return EXIT_SUCCESS;
 }
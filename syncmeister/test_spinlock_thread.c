@@ -0,0 +1,101 @@
+/*
+ * test_spinlock_thread.c -- test primitive spinlock between threads
+ * Copyright (C) 2022  Jacob Koziej <jacobkoziej@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "spinlock.h"
+
+
+static struct spinlock lock;
+static unsigned long   counter;
+static unsigned long   increments;
+
+
+static void *child(void *arg)
+{
+	(void) arg;
+
+	for (unsigned long i = 0; i < increments; i++) {
+		spinlock_lock(&lock);
+		++counter;
+		spinlock_unlock(&lock);
+	}
+
+	return NULL;
+}
+
+int main(int argc, char **argv)
+{
+	unsigned long children = 0;
+
+	int opt;
+	while ((opt = getopt(argc, argv, "c:i:")) != -1) {
+		switch (opt) {
+			case 'c':
+				children = strtoul(optarg, NULL, 0);
+				break;
+
+			case 'i':
+				increments = strtoul(optarg, NULL, 0);
+				break;
+
+			default:
+				return EXIT_FAILURE;
+		}
+	}
+
+	pthread_t thread[children];
+
+	struct timespec start;
+	clock_gettime(CLOCK_MONOTONIC, &start);
+
+	for (unsigned long i = 0; i < children; i++) {
+		int err = pthread_create(&thread[i], NULL, child, NULL);
+		if (err) {
+			fprintf(stderr, "failed to `pthread_create()`: %s\n", strerror(err));
+			return EXIT_FAILURE;
+		}
+	}
+
+	for (unsigned long i = 0; i < children; i++) pthread_join(thread[i], NULL);
+
+	struct timespec end;
+	clock_gettime(CLOCK_MONOTONIC, &end);
+
+	double elapsed = (end.tv_sec - start.tv_sec)
+		+ (end.tv_nsec - start.tv_nsec) / 1e9;
+
+	printf("expected: %lu\n", increments * children);
+	printf("got:      %lu\n", counter);
+	printf("elapsed:  %.6f s\n", elapsed);
+	printf("ops/s:    %.0f\n", increments * children / elapsed);
+
+	if (counter != increments * children) {
+		puts("counter FAILED");
+		return EXIT_FAILURE;
+	}
+
+	puts("TEST PASSED");
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,98 @@
+/*
+ * test_spsc.c -- test single-producer/single-consumer FIFO
+ * Copyright (C) 2022  Jacob Koziej <jacobkoziej@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "spsc.h"
+
+
+int main(int argc, char **argv)
+{
+	unsigned long writes = 0;
+
+	int opt;
+	while ((opt = getopt(argc, argv, "w:")) != -1) {
+		switch (opt) {
+			case 'w':
+				writes = strtoul(optarg, NULL, 0);
+				break;
+
+			default:
+				return EXIT_FAILURE;
+		}
+	}
+
+	struct spsc *spsc = mmap(
+		NULL,
+		sizeof(*spsc),
+		PROT_READ | PROT_WRITE,
+		MAP_ANONYMOUS | MAP_SHARED,
+		-1,
+		0);
+
+	if (spsc == MAP_FAILED) {
+		perror("failed to `mmap()` spsc");
+		return EXIT_FAILURE;
+	}
+
+	spsc_init(spsc);
+
+	struct timespec start;
+	clock_gettime(CLOCK_MONOTONIC, &start);
+
+	switch (fork()) {
+		case -1:
+			perror("failed to `fork()` child");
+			return EXIT_FAILURE;
+
+		case 0:
+			for (unsigned long i = 0; i < writes; i++)
+				spsc_wr(spsc, i);
+
+			return EXIT_SUCCESS;
+	}
+
+	for (unsigned long i = 0; i < writes; i++) {
+		unsigned long val = spsc_rd(spsc);
+
+		if (val != i) {
+			printf("expected: %lu, got: %lu FAILED\n", i, val);
+			return EXIT_FAILURE;
+		}
+	}
+
+	wait(NULL);
+
+	struct timespec end;
+	clock_gettime(CLOCK_MONOTONIC, &end);
+
+	double elapsed = (end.tv_sec - start.tv_sec)
+		+ (end.tv_nsec - start.tv_nsec) / 1e9;
+
+	printf("elapsed:  %.6f s\n", elapsed);
+	printf("ops/s:    %.0f\n", writes / elapsed);
+
+	puts("TEST PASSED");
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,162 @@
+/*
+ * expand.c -- block tab expansion
+ * Copyright (C) 2022  Jacob Koziej <jacobkoziej@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "expand.h"
+
+#include <stddef.h>
+#include <string.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+
+// the bytes the column engine has to stop at
+static const unsigned char expand_stops[256] = {
+	['\t'] = 1,
+	['\n'] = 1,
+};
+
+
+// finds the next tab or newline, or end if there isn't one
+static const unsigned char *expand_stop(
+	const unsigned char *src,
+	const unsigned char *end)
+{
+#ifdef __SSE2__
+	// there's no two-byte memchr(), so look for both sixteen at a time
+	const __m128i tab = _mm_set1_epi8('\t');
+	const __m128i nl  = _mm_set1_epi8('\n');
+
+	while (end - src >= 16) {
+		__m128i v    = _mm_loadu_si128((const __m128i *) src);
+		int     mask = _mm_movemask_epi8(_mm_or_si128(
+			_mm_cmpeq_epi8(v, tab),
+			_mm_cmpeq_epi8(v, nl)));
+
+		if (mask) return src + __builtin_ctz(mask);
+
+		src += 16;
+	}
+#endif
+
+	while (src < end && !expand_stops[*src]) ++src;
+
+	return src;
+}
+
+
+// expands every tab in src into EXPAND_TABSIZ spaces, returning how
+// many bytes went to dst, which must have room for EXPAND_MAX(len)
+size_t expand(unsigned char *dst, const unsigned char *src, size_t len)
+{
+	unsigned char       *out = dst;
+	const unsigned char *end = src + len;
+
+	while (src < end) {
+		// memchr() is already vectorized by libc, so tab-free runs
+		// are found and copied a word or more at a time
+		const unsigned char *tab = memchr(src, '\t', end - src);
+		size_t               run = ((tab) ? tab : end) - src;
+
+		memcpy(out, src, run);
+		out += run;
+		src += run;
+
+		if (!tab) break;
+
+		memset(out, ' ', EXPAND_TABSIZ);
+		out += EXPAND_TABSIZ;
+		++src;
+	}
+
+	return out - dst;
+}
+
+// expands tabs in src out to the next multiple of width like expand(1),
+// with *col carrying the column across calls and resetting on newlines;
+// stops once the *dstlen bytes of dst are full, setting *dstlen to how
+// many were written and returning how much of src was consumed.  A tab
+// whose padding didn't fit is left unconsumed, and the column tells the
+// next call how much of it is still owed.
+size_t expand_cols(
+	unsigned char       *dst,
+	size_t              *dstlen,
+	const unsigned char *src,
+	size_t               len,
+	size_t               width,
+	size_t              *col)
+{
+	unsigned char       *out   = dst;
+	unsigned char       *limit = dst + *dstlen;
+	const unsigned char *start = src;
+	const unsigned char *end   = src + len;
+	size_t               c     = *col;
+
+	while (src < end && out < limit) {
+		size_t room = limit - out;
+
+		// a run can't be copied past the end of dst either
+		const unsigned char *stop = expand_stop(
+			src,
+			((size_t) (end - src) > room) ? src + room : end);
+		size_t               run  = stop - src;
+
+		memcpy(out, src, run);
+		out += run;
+		c   += run;
+		src  = stop;
+
+		if (src == end || out == limit) continue;
+
+		if (*src == '\n') {
+			*out++ = '\n';
+			c      = 0;
+			++src;
+			continue;
+		}
+
+		size_t pad = width - c % width;
+		size_t fit = (size_t) (limit - out);
+		if (fit > pad) fit = pad;
+
+		memset(out, ' ', fit);
+		out += fit;
+		c   += fit;
+
+		if (fit == pad) ++src;
+	}
+
+	*col    = c;
+	*dstlen = out - dst;
+
+	return src - start;
+}
+
+// counts the tabs in src, which is all it takes to know how long its
+// expansion will be
+size_t expand_count(const unsigned char *src, size_t len)
+{
+	size_t tabs = 0;
+
+	// a plain compare-and-add loop is what the compiler vectorizes
+	// best, which beats a memchr() call per tab on dense input
+	for (size_t i = 0; i < len; i++) tabs += src[i] == '\t';
+
+	return tabs;
+}
@@ -0,0 +1,43 @@
+/*
+ * expand.h -- block tab expansion
+ * Copyright (C) 2022  Jacob Koziej <jacobkoziej@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef EXPAND_H
+#define EXPAND_H
+
+
+#include <stddef.h>
+
+
+#define EXPAND_TABSIZ 4
+
+// worst case output for len bytes of input, which is all tabs
+#define EXPAND_MAX(len) ((len) * EXPAND_TABSIZ)
+
+
+size_t expand(unsigned char *dst, const unsigned char *src, size_t len);
+size_t expand_cols(
+	unsigned char       *dst,
+	size_t              *dstlen,
+	const unsigned char *src,
+	size_t               len,
+	size_t               width,
+	size_t              *col);
+size_t expand_count(const unsigned char *src, size_t len);
+
+
+#endif /* EXPAND_H */
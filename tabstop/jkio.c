@@ -23,18 +23,77 @@
 #include <fcntl.h>
 #include <stddef.h>
 #include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <sys/uio.h>
 #include <unistd.h>
 
 
+// what a stream without a buffer grows to once a record needs one
+#define JKIO_MINBUF 4096
+
+
+// reads more onto the end of what's buffered without dropping any of it
+static ssize_t myfextend(struct MYSTREAM *stream)
+{
+	// the record spans a refill, so slide what we have of it to the
+	// front and only grow once it fills the whole buffer
+	if (stream->pos != stream->buf) {
+		memmove(stream->buf, stream->pos, stream->bufuse);
+		stream->pos = stream->buf;
+	}
+
+	if (stream->bufuse == stream->bufsiz) {
+		size_t         bufsiz = (stream->bufsiz)
+			? stream->bufsiz * 2
+			: JKIO_MINBUF;
+		unsigned char *buf    = realloc(stream->buf, bufsiz);
+		if (!buf) return -1;
+
+		stream->buf    = buf;
+		stream->pos    = buf;
+		stream->bufsiz = bufsiz;
+	}
+
+	return read(
+		stream->fd,
+		stream->buf + stream->bufuse,
+		stream->bufsiz - stream->bufuse);
+}
+
+static ssize_t write_full(int fd, const unsigned char *buf, size_t nbyte)
+{
+	size_t total = 0;
+
+	while (total < nbyte) {
+		ssize_t ret = write(fd, buf + total, nbyte - total);
+		if (ret < 0) return -1;
+
+		total += ret;
+	}
+
+	return total;
+}
+
+
 int myfclose(struct MYSTREAM *stream)
 {
 	int ret = 0;
 
 	if ((stream->flags & O_WRONLY) && myfflush(stream) < 0) ret = -1;
 
+	// nothing was ever read() from a mapped file, so leave the offset
+	// just past what was consumed for whoever shares the descriptor
+	if ((stream->flags & MYF_MMAP)
+		&& lseek(stream->fd, stream->pos - stream->buf, SEEK_SET) < 0)
+		ret = -1;
+
 	if (close(stream->fd) < 0) ret = -1;
 
-	if (stream->buf) free(stream->buf);
+	if (stream->flags & MYF_MMAP) munmap(stream->buf, stream->bufsiz);
+	else if (stream->buf) free(stream->buf);
 	free(stream);
 
 	return ret;
@@ -42,7 +101,13 @@ int myfclose(struct MYSTREAM *stream)
 
 struct MYSTREAM *myfdopen(int filedesc, int mode, int bufsiz)
 {
-	if (filedesc < 0 || (mode != O_RDONLY && mode != O_WRONLY) || bufsiz < 0) {
+	int map = mode & MYF_MMAP;
+	mode   &= ~MYF_MMAP;
+
+	if (filedesc < 0
+		|| (mode != O_RDONLY && mode != O_WRONLY)
+		|| (map && mode != O_RDONLY)
+		|| bufsiz < 0) {
 		errno = EINVAL;
 		return NULL;
 	}
@@ -50,6 +115,10 @@ struct MYSTREAM *myfdopen(int filedesc, int mode, int bufsiz)
 	struct MYSTREAM *s = calloc(1, sizeof(struct MYSTREAM));
 	if (!s) return NULL;
 
+	s->fd = filedesc;
+
+	if (map && myfmap(s)) return s;
+
 	if (bufsiz) {
 		s->buf = malloc(bufsiz);
 		if (!s->buf) goto error;
@@ -57,7 +126,6 @@ struct MYSTREAM *myfdopen(int filedesc, int mode, int bufsiz)
 		s->bufsiz = bufsiz;
 	}
 
-	s->fd    = filedesc;
 	s->flags = (mode == O_RDONLY) ? O_RDONLY : O_WRONLY | O_CREAT | O_TRUNC;
 
 	return s;
@@ -70,18 +138,21 @@ error:
 
 int myfflush(struct MYSTREAM *stream)
 {
-	if (!stream->bufuse) return 0;
-
 	const unsigned char *tmp = stream->buf;
-	ssize_t              ret;
 
-	do {
-		ret = write(stream->fd, tmp, stream->bufuse);
-		if (ret < 0) return -1;
+	while (stream->bufuse) {
+		ssize_t ret = write(stream->fd, tmp, stream->bufuse);
+
+		// keep whatever didn't make it out for the next attempt
+		if (ret < 0) {
+			memmove(stream->buf, tmp, stream->bufuse);
+			stream->pos = stream->buf + stream->bufuse;
+			return -1;
+		}
 
 		tmp            += ret;
 		stream->bufuse -= ret;
-	} while (ret > 0);
+	}
 
 	stream->pos = stream->buf;
 
@@ -103,6 +174,12 @@ int myfgetc(struct MYSTREAM *stream)
 	}
 
 	if (!stream->bufuse) {
+		// a mapped file has nothing left to read
+		if (stream->flags & MYF_MMAP) {
+			errno = 0;
+			return -1;
+		}
+
 		ret = read(stream->fd, stream->buf, stream->bufsiz);
 
 		if (!ret) errno = 0;
@@ -116,9 +193,95 @@ int myfgetc(struct MYSTREAM *stream)
 	return *stream->pos++;
 }
 
+ssize_t myfgetdelim(unsigned char **ptr, int delim, struct MYSTREAM *stream)
+{
+	size_t scanned = 0;
+
+	for (;;) {
+		unsigned char *end = (stream->bufuse > scanned)
+			? memchr(stream->pos + scanned, delim, stream->bufuse - scanned)
+			: NULL;
+
+		if (end) {
+			size_t len = end - stream->pos + 1;
+
+			*ptr            = stream->pos;
+			stream->pos    += len;
+			stream->bufuse -= len;
+
+			return len;
+		}
+
+		scanned = stream->bufuse;
+
+		// a mapped file is already all there
+		ssize_t ret = (stream->flags & MYF_MMAP) ? 0 : myfextend(stream);
+		if (ret < 0) return -1;
+
+		// whatever is left over is the last record
+		if (!ret) {
+			errno = 0;
+
+			size_t len = stream->bufuse;
+
+			*ptr            = stream->pos;
+			stream->pos    += len;
+			stream->bufuse  = 0;
+
+			return len;
+		}
+
+		stream->bufuse += ret;
+	}
+}
+
+int myfileno(struct MYSTREAM *stream)
+{
+	return stream->fd;
+}
+
+int myfmap(struct MYSTREAM *stream)
+{
+	// only a reading stream that hasn't buffered anything yet can
+	// switch over without losing its place
+	if ((stream->flags & (O_WRONLY | MYF_MMAP)) || stream->bufuse) return 0;
+
+	struct stat st;
+
+	if (fstat(stream->fd, &st) < 0 || !S_ISREG(st.st_mode)) return 0;
+
+	off_t off = lseek(stream->fd, 0, SEEK_CUR);
+	if (off < 0 || off >= st.st_size) return 0;
+
+	void *map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, stream->fd, 0);
+	if (map == MAP_FAILED) return 0;
+
+	posix_madvise(map, st.st_size, POSIX_MADV_SEQUENTIAL);
+
+	free(stream->buf);
+
+	stream->buf     = map;
+	stream->pos     = stream->buf + off;
+	stream->bufsiz  = st.st_size;
+	stream->bufuse  = st.st_size - off;
+	stream->flags  |= MYF_MMAP;
+
+	return 1;
+}
+
+int myfmapped(struct MYSTREAM *stream)
+{
+	return !!(stream->flags & MYF_MMAP);
+}
+
 struct MYSTREAM *myfopen(const char *pathname, int mode, int bufsiz)
 {
-	if ((mode != O_RDONLY && mode != O_WRONLY) || bufsiz < 0) {
+	int map = mode & MYF_MMAP;
+	mode   &= ~MYF_MMAP;
+
+	if ((mode != O_RDONLY && mode != O_WRONLY)
+		|| (map && mode != O_RDONLY)
+		|| bufsiz < 0) {
 		errno = EINVAL;
 		return NULL;
 	}
@@ -133,6 +296,11 @@ struct MYSTREAM *myfopen(const char *pathname, int mode, int bufsiz)
 	struct MYSTREAM *s = calloc(1, sizeof(struct MYSTREAM));
 	if (!s) return NULL;
 
+	s->fd    = fd;
+	s->flags = flags;
+
+	if (map && myfmap(s)) return s;
+
 	if (bufsiz) {
 		s->buf = malloc(bufsiz);
 		if (!s->buf) goto error;
@@ -140,9 +308,6 @@ struct MYSTREAM *myfopen(const char *pathname, int mode, int bufsiz)
 		s->bufsiz = bufsiz;
 	}
 
-	s->fd    = fd;
-	s->flags = flags;
-
 	return s;
 
 error:
@@ -163,3 +328,121 @@ int myfputc(int c, struct MYSTREAM *stream)
 		? -1
 		: c;
 }
+
+ssize_t myfread(void *buf, size_t nbyte, struct MYSTREAM *stream)
+{
+	unsigned char *out   = buf;
+	size_t         total = 0;
+
+	while (total < nbyte) {
+		// drain what's already buffered first
+		if (stream->bufuse) {
+			size_t run = nbyte - total;
+			if (run > stream->bufuse) run = stream->bufuse;
+
+			memcpy(out + total, stream->pos, run);
+			stream->pos    += run;
+			stream->bufuse -= run;
+
+			total += run;
+			continue;
+		}
+
+		// a mapped file has nothing left to read
+		if (stream->flags & MYF_MMAP) {
+			errno = 0;
+			break;
+		}
+
+		ssize_t ret;
+
+		// a request at least as big as the buffer gains nothing from
+		// being staged through it
+		if (nbyte - total >= stream->bufsiz) {
+			ret = read(stream->fd, out + total, nbyte - total);
+			if (ret > 0) {
+				total += ret;
+				continue;
+			}
+		} else {
+			ret = read(stream->fd, stream->buf, stream->bufsiz);
+			if (ret > 0) {
+				stream->pos    = stream->buf;
+				stream->bufuse = ret;
+				continue;
+			}
+		}
+
+		if (!ret) {
+			errno = 0;
+			break;
+		}
+
+		// hand back what we have and let the next call report it
+		return (total) ? (ssize_t) total : -1;
+	}
+
+	return total;
+}
+
+ssize_t myfwrite(const void *buf, size_t nbyte, struct MYSTREAM *stream)
+{
+	const unsigned char *in = buf;
+
+	// keep what we're given in order behind anything already buffered
+	if (stream->bufuse + nbyte >= stream->bufsiz) {
+		if (myfflush(stream) < 0) return -1;
+
+		if (nbyte >= stream->bufsiz)
+			return write_full(stream->fd, in, nbyte);
+	}
+
+	memcpy(stream->pos, in, nbyte);
+	stream->pos    += nbyte;
+	stream->bufuse += nbyte;
+
+	return nbyte;
+}
+
+ssize_t myfwritev(const struct iovec *iov, int iovcnt, struct MYSTREAM *stream)
+{
+	// keep what we're given in order behind anything already buffered
+	if (myfflush(stream) < 0) return -1;
+
+	long   iovmax = sysconf(_SC_IOV_MAX);
+	size_t total  = 0;
+
+	if (iovmax <= 0) iovmax = 16;
+
+	while (iovcnt > 0) {
+		ssize_t ret = writev(
+			stream->fd,
+			iov,
+			(iovcnt < iovmax) ? iovcnt : iovmax);
+		if (ret < 0) return -1;
+
+		total += ret;
+
+		// skip past whatever went out whole
+		while (iovcnt && (size_t) ret >= iov->iov_len) {
+			ret -= iov->iov_len;
+			++iov;
+			--iovcnt;
+		}
+
+		if (!ret) continue;
+
+		// and finish off the one that was cut short by hand
+		ssize_t rem = write_full(
+			stream->fd,
+			(const unsigned char *) iov->iov_base + ret,
+			iov->iov_len - ret);
+		if (rem < 0) return -1;
+
+		total += rem;
+		++iov;
+		--iovcnt;
+	}
+
+	return total;
+}
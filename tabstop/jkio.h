@@ -20,15 +20,52 @@
 #define JKIO_H
 
 
-struct MYSTREAM;
+#include <stddef.h>
+#include <sys/types.h>
+#include <sys/uio.h>
+
+#include "jkio_private.h"
+
+
+// or'd into the mode of a reading stream to map a regular file whole
+// instead of reading it; anything else quietly falls back on a buffer
+#define MYF_MMAP (1 << 30)
+
+
+// like getc()/putc(), these only fall back on a function call when the
+// buffer runs dry or fills up, and may evaluate stream more than once
+#define mygetc(stream) \
+	(((stream)->bufuse) \
+		? (--(stream)->bufuse, *(stream)->pos++) \
+		: myfgetc(stream))
+#define myputc(c, stream) \
+	(((stream)->bufuse + 1 < (stream)->bufsiz) \
+		? (++(stream)->bufuse, *(stream)->pos++ = (unsigned char) (c)) \
+		: myfputc((c), (stream)))
 
 
 int              myfclose(struct MYSTREAM *stream);
 struct MYSTREAM *myfdopen(int filedesc, int mode, int bufsiz);
 int              myfflush(struct MYSTREAM *stream);
 int              myfgetc(struct MYSTREAM *stream);
+// myfgetdelim() points *ptr at the next record, delimiter included,
+// inside the stream's own buffer; it stays valid until the next call
+// on the stream.  Returns the record length, 0 at the end of the file,
+// or -1 with errno set if reading or growing the buffer failed.  On a
+// mapped stream every record is a view straight into the file.
+ssize_t          myfgetdelim(unsigned char **ptr, int delim, struct MYSTREAM *stream);
+int              myfileno(struct MYSTREAM *stream);
+// myfmap() maps the rest of a regular file as the buffer of a reading
+// stream that hasn't buffered anything yet, same as opening it with
+// MYF_MMAP; returns 1 if it did.  The file mustn't shrink while mapped,
+// or reading past its new end faults.
+int              myfmap(struct MYSTREAM *stream);
+int              myfmapped(struct MYSTREAM *stream);
 struct MYSTREAM *myfopen(const char *pathname, int mode, int bufsiz);
 int              myfputc(int c, struct MYSTREAM *stream);
+ssize_t          myfread(void *buf, size_t nbyte, struct MYSTREAM *stream);
+ssize_t          myfwrite(const void *buf, size_t nbyte, struct MYSTREAM *stream);
+ssize_t          myfwritev(const struct iovec *iov, int iovcnt, struct MYSTREAM *stream);
 
 
 #endif /* JKIO_H */
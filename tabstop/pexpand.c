@@ -0,0 +1,262 @@
+/*
+ * pexpand.c -- parallel tab expansion
+ * Copyright (C) 2022  Jacob Koziej <jacobkoziej@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "pexpand.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include "expand.h"
+
+
+#define PEXPAND_ALIGN 4096
+
+
+struct pexpand_job {
+	pthread_t thread;
+	int       rfd;
+	int       wfd;
+	off_t     rd;
+	off_t     wr;
+	size_t    len;
+	size_t    bufsiz;
+	size_t    tabs;
+	int       err;
+};
+
+
+static int pread_full(int fd, unsigned char *buf, size_t nbyte, off_t off)
+{
+	while (nbyte) {
+		ssize_t ret = pread(fd, buf, nbyte, off);
+		if (ret < 0) return -1;
+
+		// the file shrank out from under us
+		if (!ret) {
+			errno = EIO;
+			return -1;
+		}
+
+		buf   += ret;
+		nbyte -= ret;
+		off   += ret;
+	}
+
+	return 0;
+}
+
+static int pwrite_full(int fd, const unsigned char *buf, size_t nbyte, off_t off)
+{
+	while (nbyte) {
+		ssize_t ret = pwrite(fd, buf, nbyte, off);
+		if (ret < 0) return -1;
+
+		buf   += ret;
+		nbyte -= ret;
+		off   += ret;
+	}
+
+	return 0;
+}
+
+// first pass: all a chunk needs to know to find its place in the output
+// is how many tabs came before it
+static void *pexpand_count(void *arg)
+{
+	struct pexpand_job *job = arg;
+
+	unsigned char *buf = malloc(job->bufsiz);
+	if (!buf) {
+		job->err = errno;
+		return NULL;
+	}
+
+	for (size_t off = 0; off < job->len;) {
+		size_t len = job->len - off;
+		if (len > job->bufsiz) len = job->bufsiz;
+
+		if (pread_full(job->rfd, buf, len, job->rd + off) < 0) {
+			job->err = errno;
+			break;
+		}
+
+		job->tabs += expand_count(buf, len);
+		off       += len;
+	}
+
+	free(buf);
+
+	return NULL;
+}
+
+// second pass: expand the chunk into its own stretch of the output
+static void *pexpand_expand(void *arg)
+{
+	struct pexpand_job *job = arg;
+
+	unsigned char *ibuf = malloc(job->bufsiz);
+	unsigned char *obuf = malloc(EXPAND_MAX(job->bufsiz));
+	if (!ibuf || !obuf) {
+		job->err = errno;
+		goto error;
+	}
+
+	off_t wr = job->wr;
+
+	for (size_t off = 0; off < job->len;) {
+		size_t len = job->len - off;
+		if (len > job->bufsiz) len = job->bufsiz;
+
+		if (pread_full(job->rfd, ibuf, len, job->rd + off) < 0) {
+			job->err = errno;
+			break;
+		}
+
+		size_t olen = expand(obuf, ibuf, len);
+
+		if (pwrite_full(job->wfd, obuf, olen, wr) < 0) {
+			job->err = errno;
+			break;
+		}
+
+		off += len;
+		wr  += olen;
+	}
+
+error:
+	free(ibuf);
+	free(obuf);
+
+	return NULL;
+}
+
+// runs every job, the first one on the calling thread, returning the
+// first error any of them hit
+static int pexpand_run(
+	struct pexpand_job *job,
+	unsigned            jobs,
+	void               *(*fn)(void *))
+{
+	// a job we can't get a thread for just runs here instead
+	for (unsigned i = 1; i < jobs; i++)
+		if (pthread_create(&job[i].thread, NULL, fn, &job[i])) {
+			job[i].thread = pthread_self();
+			fn(&job[i]);
+		}
+
+	fn(&job[0]);
+
+	for (unsigned i = 1; i < jobs; i++)
+		if (!pthread_equal(job[i].thread, pthread_self()))
+			pthread_join(job[i].thread, NULL);
+
+	for (unsigned i = 0; i < jobs; i++)
+		if (job[i].err) return job[i].err;
+
+	return 0;
+}
+
+
+ssize_t pexpand(int rfd, int wfd, size_t bufsiz, unsigned jobs, size_t *rlen)
+{
+	struct stat st;
+	if (fstat(rfd, &st) < 0) return -1;
+
+	off_t rbase = lseek(rfd, 0, SEEK_CUR);
+	off_t wbase = lseek(wfd, 0, SEEK_CUR);
+	if (rbase < 0 || wbase < 0) return -1;
+
+	size_t len = (st.st_size > rbase) ? (size_t) (st.st_size - rbase) : 0;
+
+	// small inputs aren't worth the threads
+	if (jobs > len / PEXPAND_MINCHUNK) jobs = len / PEXPAND_MINCHUNK;
+	if (jobs > PEXPAND_MAXJOBS) jobs = PEXPAND_MAXJOBS;
+	if (!jobs) jobs = 1;
+
+	// keep chunk boundaries on page boundaries, rounding up so that
+	// the chunks always cover all of the input
+	size_t chunk = ((len + jobs - 1) / jobs + PEXPAND_ALIGN - 1)
+		& ~(size_t) (PEXPAND_ALIGN - 1);
+
+	struct pexpand_job job[jobs];
+
+	for (unsigned i = 0; i < jobs; i++) {
+		size_t off = i * chunk;
+
+		job[i] = (struct pexpand_job) {
+			.rfd    = rfd,
+			.wfd    = wfd,
+			.rd     = rbase + off,
+			.len    = (off < len) ? ((len - off < chunk) ? len - off : chunk) : 0,
+			.bufsiz = bufsiz,
+		};
+	}
+
+	int err = pexpand_run(job, jobs, pexpand_count);
+	if (err) {
+		errno = err;
+		return -1;
+	}
+
+	// tabs are context-free, so a prefix sum of the counts places
+	// every chunk's output exactly
+	off_t wr = wbase;
+
+	for (unsigned i = 0; i < jobs; i++) {
+		job[i].wr  = wr;
+		wr        += job[i].len + job[i].tabs * (EXPAND_TABSIZ - 1);
+	}
+
+	// presize the output so the jobs only ever write into the middle
+	if (ftruncate(wfd, wr) < 0) return -1;
+
+	err = pexpand_run(job, jobs, pexpand_expand);
+	if (err) {
+		errno = err;
+		return -1;
+	}
+
+	// leave both offsets where a serial pass would have
+	if (lseek(rfd, rbase + len, SEEK_SET) < 0) return -1;
+	if (lseek(wfd, wr, SEEK_SET) < 0) return -1;
+
+	*rlen = len;
+
+	return wr - wbase;
+}
+
+int pexpand_ok(int rfd, int wfd)
+{
+	struct stat rst;
+	struct stat wst;
+
+	if (fstat(rfd, &rst) < 0 || fstat(wfd, &wst) < 0) return 0;
+
+	if (!S_ISREG(rst.st_mode) || !S_ISREG(wst.st_mode)) return 0;
+
+	// an appending descriptor ignores the offset of every pwrite()
+	int flags = fcntl(wfd, F_GETFL);
+
+	return flags >= 0 && !(flags & O_APPEND);
+}
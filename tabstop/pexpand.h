@@ -0,0 +1,41 @@
+/*
+ * pexpand.h -- parallel tab expansion
+ * Copyright (C) 2022  Jacob Koziej <jacobkoziej@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef PEXPAND_H
+#define PEXPAND_H
+
+
+#include <stddef.h>
+#include <sys/types.h>
+
+
+#define PEXPAND_MAXJOBS  256
+#define PEXPAND_MINCHUNK (1 << 20)
+
+
+// pexpand() expands all of rfd from its current offset into wfd at its
+// own, splitting the input across up to jobs threads which each write
+// their share straight to where it belongs.  Both have to be regular
+// files that can be written at an offset, which pexpand_ok() checks.
+// Returns how many bytes were written and sets *rlen to how many were
+// read.
+ssize_t pexpand(int rfd, int wfd, size_t bufsiz, unsigned jobs, size_t *rlen);
+int     pexpand_ok(int rfd, int wfd);
+
+
+#endif /* PEXPAND_H */
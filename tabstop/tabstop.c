@@ -23,15 +23,31 @@
 #include <stddef.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <time.h>
 #include <unistd.h>
 
+#include "expand.h"
+#include "pexpand.h"
 
-#define TABSTOP_BUFSIZ 4096
+
+#define TABSTOP_BUFSIZ   4096
+#define TABSTOP_IOVCNT   1024
+#define TABSTOP_SPANMIN  256
+#define TABSTOP_STAGESIZ (1 << 16)
 
 
 static struct MYSTREAM *rfp;
 static struct MYSTREAM *wfp;
 
+static unsigned char *ibuf;
+static unsigned char *obuf;
+
+static size_t rbytes;
+static size_t wbytes;
+
 
 static void cleanup(void)
 {
@@ -45,6 +61,219 @@ static void cleanup(void)
 			perror("couldn't close writing stream");
 		wfp = NULL;
 	}
+
+	free(ibuf);
+	free(obuf);
+}
+
+static int same_file(int fd1, int fd2)
+{
+	struct stat st1;
+	struct stat st2;
+
+	if (fstat(fd1, &st1) < 0 || fstat(fd2, &st2) < 0) return 0;
+
+	return st1.st_dev == st2.st_dev && st1.st_ino == st2.st_ino;
+}
+
+// the original engine, kept around with -c as a reference
+static int tabstop_char(void)
+{
+	errno = 0;
+	int val;
+	while ((val = mygetc(rfp)) != -1) {
+		if (errno) {
+			perror("couldn't get character from stream");
+			return 255;
+		}
+
+		++rbytes;
+
+		// check if we need to make a 4-space tabstop
+		int lim = (val == '\t') ? val = ' ', 4 : 1;
+
+		for (int i = 0; i < lim; i++)
+			if (myputc(val, wfp) < 0) {
+				perror("couldn't put character to stream");
+				return 255;
+			}
+
+		wbytes += lim;
+	}
+
+	if (errno) {
+		perror("couldn't get character from stream");
+		return 255;
+	}
+
+	return 0;
+}
+
+static int tabstop_block(size_t bufsiz)
+{
+	ibuf = malloc(bufsiz);
+	obuf = malloc(EXPAND_MAX(bufsiz));
+	if (!ibuf || !obuf) {
+		perror("couldn't allocate buffers");
+		return 255;
+	}
+
+	// both transfers are at least a buffer's worth, so jkio passes them
+	// straight through to read() and write()
+	ssize_t ret;
+	while ((ret = myfread(ibuf, bufsiz, rfp)) > 0) {
+		size_t len = expand(obuf, ibuf, ret);
+
+		if (myfwrite(obuf, len, wfp) < 0) {
+			perror("couldn't write to stream");
+			return 255;
+		}
+
+		rbytes += ret;
+		wbytes += len;
+	}
+
+	if (ret < 0) {
+		perror("couldn't read from stream");
+		return 255;
+	}
+
+	return 0;
+}
+
+// a mapped file never needs reading into a buffer: long spans between
+// tabs go out straight from the mapping, while short ones and the spaces
+// standing in for tabs are gathered into a staging buffer so the kernel
+// isn't handed a crowd of tiny iovecs
+static int tabstop_mmap(void)
+{
+	obuf = malloc(TABSTOP_STAGESIZ);
+	if (!obuf) {
+		perror("couldn't allocate buffers");
+		return 255;
+	}
+
+	struct iovec iov[TABSTOP_IOVCNT];
+	int          cnt    = 0;
+	size_t       staged = 0;
+
+	unsigned char *span;
+	ssize_t        len;
+	while ((len = myfgetdelim(&span, '\t', rfp)) > 0) {
+		rbytes += len;
+
+		size_t tab  = (span[len - 1] == '\t') ? EXPAND_TABSIZ : 0;
+		size_t copy = len - !!tab;
+
+		// leave room for both the span and its tab
+		if (cnt > TABSTOP_IOVCNT - 2
+			|| staged + copy + tab > TABSTOP_STAGESIZ) {
+			if (myfwritev(iov, cnt, wfp) < 0) {
+				perror("couldn't write to stream");
+				return 255;
+			}
+
+			cnt    = 0;
+			staged = 0;
+		}
+
+		wbytes += copy + tab;
+
+		if (copy >= TABSTOP_SPANMIN) {
+			iov[cnt++] = (struct iovec) {
+				.iov_base = span,
+				.iov_len  = copy,
+			};
+
+			copy = 0;
+		}
+
+		if (!(copy + tab)) continue;
+
+		unsigned char *dst = obuf + staged;
+
+		memcpy(dst, span, copy);
+		memset(dst + copy, ' ', tab);
+		staged += copy + tab;
+
+		// keep growing the last iovec while it ends where we are
+		if (cnt
+			&& (unsigned char *) iov[cnt - 1].iov_base
+				+ iov[cnt - 1].iov_len == dst)
+			iov[cnt - 1].iov_len += copy + tab;
+		else iov[cnt++] = (struct iovec) {
+			.iov_base = dst,
+			.iov_len  = copy + tab,
+		};
+	}
+
+	if (len < 0) {
+		perror("couldn't read from stream");
+		return 255;
+	}
+
+	if (cnt && myfwritev(iov, cnt, wfp) < 0) {
+		perror("couldn't write to stream");
+		return 255;
+	}
+
+	return 0;
+}
+
+// expand(1) semantics: a tab pads out to the next multiple of width,
+// so the column has to be carried from one buffer to the next
+static int tabstop_cols(size_t bufsiz, size_t width)
+{
+	// the engine hands the output back whenever it fills up, even in
+	// the middle of a tab, so its size has nothing to do with width
+	size_t obufsiz = EXPAND_MAX(bufsiz);
+
+	ibuf = malloc(bufsiz);
+	obuf = malloc(obufsiz);
+	if (!ibuf || !obuf) {
+		perror("couldn't allocate buffers");
+		return 255;
+	}
+
+	size_t  col = 0;
+	ssize_t ret;
+	while ((ret = myfread(ibuf, bufsiz, rfp)) > 0) {
+		for (size_t off = 0; off < (size_t) ret;) {
+			size_t len = obufsiz;
+
+			off += expand_cols(obuf, &len, ibuf + off, ret - off, width, &col);
+
+			if (myfwrite(obuf, len, wfp) < 0) {
+				perror("couldn't write to stream");
+				return 255;
+			}
+
+			wbytes += len;
+		}
+
+		rbytes += ret;
+	}
+
+	if (ret < 0) {
+		perror("couldn't read from stream");
+		return 255;
+	}
+
+	return 0;
+}
+
+static int tabstop_parallel(unsigned jobs, size_t bufsiz)
+{
+	ssize_t ret = pexpand(myfileno(rfp), myfileno(wfp), bufsiz, jobs, &rbytes);
+
+	if (ret < 0) {
+		perror("couldn't expand in parallel");
+		return 255;
+	}
+
+	wbytes = ret;
+
+	return 0;
 }
 
 int main(int argc, char **argv)
@@ -55,9 +284,13 @@ int main(int argc, char **argv)
 	const char *rpath  = NULL;
 	const char *wpath  = NULL;
 	size_t      bufsiz = TABSTOP_BUFSIZ;
+	int         legacy = 0;
+	unsigned    jobs   = 1;
+	size_t      width  = 0;
+	int         stats  = 0;
 
 	opterr = 0;
-	while ((opt = getopt(argc, argv, ":b:ho:")) != -1) {
+	while ((opt = getopt(argc, argv, ":b:chj:o:st:")) != -1) {
 		switch (opt) {
 			case 'b':;
 				// get largest power of 2 up to 64Ki
@@ -71,17 +304,47 @@ int main(int argc, char **argv)
 					}
 				break;
 
+			case 'c':
+				legacy = 1;
+				break;
+
 			case 'h':
 				printf(
-					"usage: %s [-b bufsiz] [-o output] [FILE]\n",
+					"usage: %s [-b bufsiz] [-c] [-j jobs] [-o output] [-s] [-t width] [FILE]\n",
 					argv[0]
 				);
 				return 0;
 
+			case 'j':;
+				unsigned long njobs = strtoul(optarg, NULL, 0);
+
+				jobs = (njobs > PEXPAND_MAXJOBS)
+					? PEXPAND_MAXJOBS
+					: (njobs) ? njobs : 1;
+				break;
+
 			case 'o':
 				wpath = optarg;
 				break;
 
+			case 's':
+				stats = 1;
+				break;
+
+			case 't':;
+				char *end;
+
+				errno = 0;
+				width = strtoul(optarg, &end, 0);
+				if (!width
+					|| errno
+					|| *end
+					|| *optarg == '-') {
+					fprintf(stderr, "invalid tab width: '%s'\n", optarg);
+					return 255;
+				}
+				break;
+
 			case ':':
 				fprintf(
 					stderr,
@@ -113,6 +376,11 @@ int main(int argc, char **argv)
 		}
 	}
 
+	if (legacy && width) {
+		fputs("-c always expands to four spaces, so it can't take -t\n", stderr);
+		return 255;
+	}
+
 	if (argc - optind) rpath = argv[argc - 1];
 	rfp = (rpath)
 		? myfopen(rpath, O_RDONLY, bufsiz)
@@ -130,22 +398,59 @@ int main(int argc, char **argv)
 		return 255;
 	}
 
-	errno = 0;
-	int val;
-	while ((val = myfgetc(rfp)) != -1) {
-		if (errno) {
-			perror("couldn't get character from stream");
-			return 255;
-		}
+	// splitting the work up needs both ends to be seekable files, and
+	// columns don't survive being split at all
+	int parallel = jobs > 1
+		&& !legacy
+		&& !width
+		&& pexpand_ok(myfileno(rfp), myfileno(wfp));
 
-		// check if we need to make a 4-space tabstop
-		int lim = (val == '\t') ? val = ' ', 4 : 1;
+	// regular files get mapped, while pipes and ttys stay buffered; this
+	// waits for the output to be opened, since writing over the input
+	// truncates it out from under the mapping.  The parallel engine
+	// reads with pread() and moves the offset itself.
+	if (!legacy && !parallel && !same_file(myfileno(rfp), myfileno(wfp)))
+		myfmap(rfp);
 
-		for (int i = 0; i < lim; i++)
-			if (myfputc(val, wfp) < 0) {
-				perror("couldn't put character to stream");
-				return 255;
-			}
+	struct timespec start;
+	clock_gettime(CLOCK_MONOTONIC, &start);
+
+	const char *engine = (legacy)
+		? "char"
+		: (width) ? "column"
+		: (parallel) ? "parallel"
+		: (myfmapped(rfp)) ? "mmap" : "block";
+
+	int ret = (legacy)
+		? tabstop_char()
+		: (width) ? tabstop_cols(bufsiz, width)
+		: (parallel) ? tabstop_parallel(jobs, bufsiz)
+		: (myfmapped(rfp)) ? tabstop_mmap() : tabstop_block(bufsiz);
+	if (ret) return ret;
+
+	// whatever is still sitting in the stream buffer goes out last
+	if (myfflush(wfp) < 0) {
+		perror("couldn't flush writing stream");
+		return 255;
+	}
+
+	if (stats) {
+		struct timespec end;
+		clock_gettime(CLOCK_MONOTONIC, &end);
+
+		double elapsed = (end.tv_sec - start.tv_sec)
+			+ (end.tv_nsec - start.tv_nsec) / 1e9;
+
+		fprintf(
+			stderr,
+			"engine:  %s\nread:    %zu bytes\nwrote:   %zu bytes\n"
+			"elapsed: %.6f s\nrate:    %.3f GB/s\n",
+			engine,
+			rbytes,
+			wbytes,
+			elapsed,
+			(elapsed > 0) ? rbytes / elapsed / 1e9 : 0
+		);
 	}
 
 	return 0;